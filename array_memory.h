@@ -0,0 +1,168 @@
+// Storage for the engine's large arrays.
+//
+// AlignedAllocator hands out cache-line aligned memory for the batch
+// components and entity stores. Two optional policies apply to large
+// allocations: a first-touch hook that lets the engine place pages on NUMA
+// nodes, and huge-page backing (Linux only) to cut TLB misses. Both are off
+// by default; elsewhere the allocator is plain posix_memalign.
+
+#ifndef ARRAY_MEMORY_H
+#define ARRAY_MEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Called on every fresh allocation of at least FIRST_TOUCH_MIN_BYTES before
+// it is used, so the engine can decide which NUMA node each page lands on
+typedef void (*FirstTouchHook)(void* memory, size_t bytes);
+const size_t FIRST_TOUCH_MIN_BYTES = 1 << 20;
+
+inline FirstTouchHook& firstTouchHook() {
+    static FirstTouchHook hook = nullptr;
+    return hook;
+}
+
+// Huge-page backing for large arrays, off unless enabled. An array of at
+// least HUGE_PAGE_SIZE gets its own mapping: explicit huge pages
+// (MAP_HUGETLB) when the system has some reserved, otherwise 2 MB aligned
+// memory advised for transparent huge pages. When neither works the
+// allocator falls back to ordinary memory, so enabling this never fails.
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+class HugePages {
+public:
+    struct Stats {
+        std::atomic<long> explicitMappings{0}, transparentMappings{0}, fallbacks{0};
+    };
+
+    static bool& enabled() {
+        static bool on = false;
+        return on;
+    }
+
+    static Stats& stats() {
+        static Stats counts;
+        return counts;
+    }
+
+    // Memory for bytes >= HUGE_PAGE_SIZE, or nullptr to use the normal path
+    static void* allocate(size_t bytes) {
+#ifdef __linux__
+        size_t length = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+        void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            ++stats().explicitMappings;
+            remember(memory, length);
+            return memory;
+        }
+#endif
+#ifdef MADV_HUGEPAGE
+        // Over-map by one huge page and trim, so the range starts on a 2 MB boundary
+        void* region = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region != MAP_FAILED) {
+            uintptr_t start = reinterpret_cast<uintptr_t>(region);
+            uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+            if (aligned > start) munmap(region, aligned - start);
+            munmap(reinterpret_cast<void*>(aligned + length), start + HUGE_PAGE_SIZE - aligned);
+            void* memory = reinterpret_cast<void*>(aligned);
+            if (madvise(memory, length, MADV_HUGEPAGE) == 0) {
+                ++stats().transparentMappings;
+                remember(memory, length);
+                return memory;
+            }
+            munmap(memory, length);
+        }
+#endif
+#else
+        (void)bytes;
+#endif
+        ++stats().fallbacks;
+        return nullptr;
+    }
+
+    // Unmap memory that came from allocate; false if it did not
+    static bool release(void* memory) {
+#ifdef __linux__
+        size_t length;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            auto mapping = registry().find(memory);
+            if (mapping == registry().end()) return false;
+            length = mapping->second;
+            registry().erase(mapping);
+        }
+        munmap(memory, length);
+        return true;
+#else
+        (void)memory;
+        return false;
+#endif
+    }
+
+    // Whether memory is the start of a mapping made by allocate
+    static bool isMapped(const void* memory) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        return registry().count(const_cast<void*>(memory)) > 0;
+    }
+
+private:
+    static void remember(void* memory, size_t length) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry()[memory] = length;
+    }
+    // Never destroyed: global arrays are released after function statics
+    static std::mutex& registryMutex() {
+        static std::mutex* mutex = new std::mutex();
+        return *mutex;
+    }
+    static std::map<void*, size_t>& registry() {
+        static std::map<void*, size_t>* mappings = new std::map<void*, size_t>();
+        return *mappings;
+    }
+};
+
+// Cache-line aligned storage for batch components, huge-page backed when
+// large and HugePages is enabled
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+    static const size_t ALIGNMENT = 64;
+
+    AlignedAllocator() {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        const size_t bytes = count * sizeof(T);
+        void* memory = nullptr;
+        if (bytes >= HUGE_PAGE_SIZE && HugePages::enabled()) memory = HugePages::allocate(bytes);
+        if (!memory && posix_memalign(&memory, ALIGNMENT, bytes) != 0) throw std::bad_alloc();
+        if (bytes >= FIRST_TOUCH_MIN_BYTES && firstTouchHook()) firstTouchHook()(memory, bytes);
+        return static_cast<T*>(memory);
+    }
+    void deallocate(T* pointer, size_t count) {
+        if (count * sizeof(T) >= HUGE_PAGE_SIZE && HugePages::release(pointer)) return;
+        std::free(pointer);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<float, AlignedAllocator<float>> FloatArray;
+typedef std::vector<int, AlignedAllocator<int>> IntArray;
+typedef std::vector<unsigned char, AlignedAllocator<unsigned char>> ByteArray;
+
+#endif // ARRAY_MEMORY_H
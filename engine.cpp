@@ -1,5 +1,7 @@
 // Compile with:
-// g++ -std=c++11 -Wall -g -o missile_simulation missile_simulation.cpp -lallegro -lallegro_primitives -lallegro_font -lallegro_ttf -lpthread
+// g++ -std=c++14 -Wall -g -o missile_simulation missile_simulation.cpp -lallegro -lallegro_primitives -lallegro_font -lallegro_ttf -lpthread
+// Add -DHEADLESS for a build without visual effects, -DENGINE_EXACT_MATH to use
+// exact <cmath> calls instead of the fast approximations in fast_math.h.
 
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_primitives.h>
@@ -13,6 +15,43 @@
 #include <algorithm>
 #include <iostream> // For std::cout and std::cerr
 #include <memory>   // For std::shared_ptr and std::weak_ptr
+#include "fast_math.h"
+#include "vec_math.h"
+#include "event_log.h"
+#include <queue>
+#include <map>
+#include <unordered_map>
+#include <limits>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <deque>
+#include <type_traits>
+#ifdef __linux__
+// Metrics server, NUMA placement and hardware counters; elsewhere they are no-ops
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // Constants
 const float SCREEN_WIDTH = 800.0f;
@@ -22,382 +61,5589 @@ const float FPS = 60.0f;
 // Global variables
 std::vector<std::shared_ptr<class EnemyTarget>> enemyTargets;
 std::vector<std::shared_ptr<class DefenseMissile>> defenseMissiles;
+std::vector<std::shared_ptr<class Launcher>> launchers;
 std::mutex dataMutex;
 
-// EnemyTarget class definition
-class EnemyTarget {
+// Sides of the engagement; each keeps its own visibility grid
+enum Side { SIDE_DEFENSE = 0, SIDE_ATTACK = 1, SIDE_COUNT = 2 };
+
+// Area a sensor currently has stamped into a visibility grid
+struct SensorFootprint {
+    int cell = -1;      // Centre cell, -1 when not stamped
+    float range = 0.0f;
+    bool shaped = false;    // Stamped by updateShapedSensor rather than as a disc
+    long revision = -1;     // Shape revision of a shaped sensor
+    std::vector<int> cells; // Cells a shaped sensor stamped
+};
+
+// VisibilityGrid class definition
+// Per-side coverage counts: each cell holds how many sensors see it. A sensor
+// only re-stamps its disc when it moves to another cell or changes range, so
+// the per-tick cost follows sensor changes and lookups are a single read.
+class VisibilityGrid {
 public:
-    EnemyTarget(float x, float y, float speedX, float speedY)
-        : x(x), y(y), speedX(speedX), speedY(speedY), id(nextID++) {}
+    VisibilityGrid(float width, float height, float cellSize)
+        : cellSize(cellSize),
+          cols(static_cast<int>(std::ceil(width / cellSize))),
+          rows(static_cast<int>(std::ceil(height / cellSize))),
+          coverage(cols * rows, 0) {}
 
-    void update(float deltaTime) {
-        x += speedX * deltaTime;
-        y += speedY * deltaTime;
+    void updateSensor(SensorFootprint& footprint, float x, float y, float range) {
+        int cell = cellAt(x, y);
+        if (cell == footprint.cell && range == footprint.range) return;
+        removeSensor(footprint);
+        stamp(cell, range, 1);
+        footprint.cell = cell;
+        footprint.range = range;
+    }
 
-        // Remove target if it goes off-screen
-        if (x > SCREEN_WIDTH || y < 0 || y > SCREEN_HEIGHT) {
-            isActive = false;
+    // Sensor whose coverage is not a disc (a jammed radar): every cell within
+    // range whose centre offset covers(dx, dy) accepts. Re-stamped only when
+    // the caller's shape revision changes.
+    template <typename Covers>
+    void updateShapedSensor(SensorFootprint& footprint, float x, float y, float range, long revision,
+                            const Covers& covers) {
+        if (footprint.cell >= 0 && footprint.shaped && footprint.revision == revision) return;
+        removeSensor(footprint);
+        int cx = cellAt(x, y) % cols;
+        int cy = cellAt(x, y) / cols;
+        int radiusCells = static_cast<int>(std::ceil(range / cellSize));
+        for (int row = std::max(cy - radiusCells, 0); row <= std::min(cy + radiusCells, rows - 1); ++row) {
+            for (int col = std::max(cx - radiusCells, 0); col <= std::min(cx + radiusCells, cols - 1); ++col) {
+                float dx = (col + 0.5f) * cellSize - x;
+                float dy = (row + 0.5f) * cellSize - y;
+                if (dx * dx + dy * dy > range * range || !covers(dx, dy)) continue;
+                ++coverage[row * cols + col];
+                footprint.cells.push_back(row * cols + col);
+            }
         }
+        footprint.cell = cellAt(x, y);
+        footprint.range = range;
+        footprint.shaped = true;
+        footprint.revision = revision;
     }
 
-    void draw() const {
-        al_draw_filled_circle(x, y, 10, al_map_rgb(255, 0, 0));
+    void removeSensor(SensorFootprint& footprint) {
+        if (footprint.cell < 0) return;
+        if (footprint.shaped) {
+            for (int cell : footprint.cells) --coverage[cell];
+            footprint.cells.clear();
+            footprint.shaped = false;
+        } else {
+            stamp(footprint.cell, footprint.range, -1);
+        }
+        footprint.cell = -1;
     }
 
-    float getX() const { return x; }
-    float getY() const { return y; }
-    float getSpeedX() const { return speedX; }
-    float getSpeedY() const { return speedY; }
-    bool isActiveTarget() const { return isActive; }
-    void setInactive() { isActive = false; }
-
-    int getID() const { return id; }
+    bool isVisible(float x, float y) const { return coverage[cellAt(x, y)] > 0; }
+    int getCoverage(float x, float y) const { return coverage[cellAt(x, y)]; }
 
 private:
-    float x, y;
-    float speedX, speedY;
-    bool isActive = true;
-    int id;
-    static int nextID;
+    int cellAt(float x, float y) const {
+        int cx = std::min(std::max(static_cast<int>(x / cellSize), 0), cols - 1);
+        int cy = std::min(std::max(static_cast<int>(y / cellSize), 0), rows - 1);
+        return cy * cols + cx;
+    }
+
+    // Add delta to every cell whose centre lies within range of the centre cell
+    void stamp(int cell, float range, int delta) {
+        int cx = cell % cols;
+        int cy = cell / cols;
+        float radius = range / cellSize;
+        int radiusCells = static_cast<int>(radius);
+        for (int dy = -radiusCells; dy <= radiusCells; ++dy) {
+            int y = cy + dy;
+            if (y < 0 || y >= rows) continue;
+            int halfWidth = static_cast<int>(std::sqrt(radius * radius - static_cast<float>(dy * dy)));
+            int x0 = std::max(cx - halfWidth, 0);
+            int x1 = std::min(cx + halfWidth, cols - 1);
+            for (int x = x0; x <= x1; ++x) {
+                coverage[y * cols + x] += delta;
+            }
+        }
+    }
+
+    float cellSize;
+    int cols, rows;
+    std::vector<int> coverage;
 };
 
-int EnemyTarget::nextID = 0;
+VisibilityGrid visibility[SIDE_COUNT] = {
+    VisibilityGrid(SCREEN_WIDTH, SCREEN_HEIGHT, 10.0f),
+    VisibilityGrid(SCREEN_WIDTH, SCREEN_HEIGHT, 10.0f)
+};
 
-// DefenseMissile class definition
-class DefenseMissile {
+// Sensor ranges stamped into the visibility grids
+const float RADAR_RANGE = 500.0f;
+const float LAUNCHER_SENSOR_RANGE = 120.0f;
+const float TARGET_SENSOR_RANGE = 150.0f;
+SensorFootprint radarFootprint;
+
+// WindField class definition
+// Gridded wind velocity and air density loaded from a text file, optionally
+// as several frames that are blended over time. Each cell is stored as one
+// 16-byte (u, v, density, pad) record so a bilinear sample is four vector
+// loads and four multiply-adds, whatever the grid size.
+//
+// File format: "cols rows cellSize frames frameDuration", followed by
+// frames * rows * cols "u v density" triples in row-major order. Lines
+// starting with '#' are comments.
+class WindField {
 public:
-    DefenseMissile(float x, float y, std::shared_ptr<EnemyTarget> target, float speed)
-        : x(x), y(y), speed(speed), target(target) {
-        updateVelocity();
+    bool load(const char* path) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Failed to open wind field " << path << std::endl;
+            return false;
+        }
+        std::string text, line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line[0] != '#') text += line + "\n";
+        }
+        std::istringstream in(text);
+        if (!(in >> cols >> rows >> cellSize >> frameCount >> frameDuration) ||
+            cols < 2 || rows < 2 || cellSize <= 0.0f || frameCount < 1) {
+            std::cerr << "Malformed wind field header in " << path << std::endl;
+            return false;
+        }
+        if (frameCount > 1 && !(std::isfinite(frameDuration) && frameDuration > 0.0f)) {
+            std::cerr << "Wind field " << path << " needs a positive frame duration for " << frameCount << " frames"
+                      << std::endl;
+            return false;
+        }
+        frames.resize(static_cast<size_t>(frameCount) * cols * rows * 4);
+        for (size_t i = 0; i < frames.size(); i += 4) {
+            if (!(in >> frames[i] >> frames[i + 1] >> frames[i + 2])) {
+                std::cerr << "Wind field " << path << " is missing samples" << std::endl;
+                return false;
+            }
+            frames[i + 3] = 0.0f;
+        }
+        current.assign(frames.begin(), frames.begin() + cols * rows * 4);
+        loaded = true;
+        return true;
     }
 
-    void update(float deltaTime) {
-        if (auto sharedTarget = target.lock()) {
-            if (sharedTarget->isActiveTarget()) {
-                // Update velocity towards the target's current position
-                updateVelocity();
-            } else {
-                // Target is inactive, missile continues in current direction
-                target.reset();
+    // Steady procedural field (a slow vortex) for benchmarks
+    void makeProcedural(int gridCols, int gridRows, float gridCellSize) {
+        cols = gridCols;
+        rows = gridRows;
+        cellSize = gridCellSize;
+        frameCount = 1;
+        frames.resize(static_cast<size_t>(cols) * rows * 4);
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < cols; ++x) {
+                float* cell = &frames[(y * cols + x) * 4];
+                cell[0] = -20.0f * (y - rows / 2.0f) / rows;
+                cell[1] = 20.0f * (x - cols / 2.0f) / cols;
+                cell[2] = 1.0f - 0.2f * y / rows;
+                cell[3] = 0.0f;
             }
         }
+        current = frames;
+        loaded = true;
+    }
 
-        x += velocityX * deltaTime;
-        y += velocityY * deltaTime;
+    bool isLoaded() const { return loaded; }
 
-        // Remove missile if it goes off-screen
-        if (x < 0 || x > SCREEN_WIDTH || y < 0 || y > SCREEN_HEIGHT) {
-            isActive = false;
+    // Blend the two frames around the given time into the sampling grid
+    void setTime(float seconds) {
+        if (!loaded || frameCount < 2) return;
+        float position = std::fmod(seconds / frameDuration, static_cast<float>(frameCount));
+        int first = static_cast<int>(position);
+        int second = (first + 1) % frameCount;
+        float t = position - first;
+        size_t cellFloats = static_cast<size_t>(cols) * rows * 4;
+        const float* a = &frames[first * cellFloats];
+        const float* b = &frames[second * cellFloats];
+        for (size_t i = 0; i < cellFloats; ++i) {
+            current[i] = a[i] + (b[i] - a[i]) * t;
         }
     }
 
-    void draw() const {
-        al_draw_filled_circle(x, y, 5, al_map_rgb(0, 255, 0));
-    }
-
-    float getX() const { return x; }
-    float getY() const { return y; }
-    bool isActiveMissile() const { return isActive; }
-    void setInactive() { isActive = false; }
+    // Bilinear sample at count points. Positions outside the grid clamp to its edge.
+    void sample(const float* px, const float* py, int count, float* windX, float* windY, float* density) const {
+        const float invCell = 1.0f / cellSize;
+        const float maxX = static_cast<float>(cols - 1) - 0.001f;
+        const float maxY = static_cast<float>(rows - 1) - 0.001f;
+        int i = 0;
+#ifdef __SSE2__
+        const __m128 scale = _mm_set1_ps(invCell);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 limitX = _mm_set1_ps(maxX);
+        const __m128 limitY = _mm_set1_ps(maxY);
+        for (; i + 4 <= count; i += 4) {
+            // Grid coordinates relative to cell centres, clamped to the grid
+            __m128 gx = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(px + i), scale), half), zero), limitX);
+            __m128 gy = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(py + i), scale), half), zero), limitY);
+            __m128i ix = _mm_cvttps_epi32(gx);
+            __m128i iy = _mm_cvttps_epi32(gy);
+            __m128 fx = _mm_sub_ps(gx, _mm_cvtepi32_ps(ix));
+            __m128 fy = _mm_sub_ps(gy, _mm_cvtepi32_ps(iy));
 
-    std::weak_ptr<EnemyTarget> target; // Make target public to access in collision detection
+            alignas(16) int cellX[4], cellY[4];
+            alignas(16) float wx[4], wy[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(cellX), ix);
+            _mm_store_si128(reinterpret_cast<__m128i*>(cellY), iy);
+            _mm_store_ps(wx, fx);
+            _mm_store_ps(wy, fy);
+            for (int lane = 0; lane < 4; ++lane) {
+                blend(cellY[lane] * cols + cellX[lane], wx[lane], wy[lane],
+                      windX + i + lane, windY + i + lane, density + i + lane);
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            float gx = std::min(std::max(px[i] * invCell - 0.5f, 0.0f), maxX);
+            float gy = std::min(std::max(py[i] * invCell - 0.5f, 0.0f), maxY);
+            int ix = static_cast<int>(gx);
+            int iy = static_cast<int>(gy);
+            blend(iy * cols + ix, gx - ix, gy - iy, windX + i, windY + i, density + i);
+        }
+    }
 
 private:
-    void updateVelocity() {
-        if (auto sharedTarget = target.lock()) {
-            float dx = sharedTarget->getX() - x;
-            float dy = sharedTarget->getY() - y;
-            float distance = std::sqrt(dx * dx + dy * dy);
-
-            if (distance > 0.01f) { // Use a small epsilon to avoid division by zero
-                velocityX = (dx / distance) * speed;
-                velocityY = (dy / distance) * speed;
-            }
+    // Weighted sum of the (u, v, density) records of the cell and its +x/+y neighbours
+    void blend(int cell, float fx, float fy, float* windX, float* windY, float* density) const {
+        const float* c00 = &current[cell * 4];
+        const float* c10 = c00 + 4;
+        const float* c01 = c00 + cols * 4;
+        const float* c11 = c01 + 4;
+#ifdef __SSE2__
+        __m128 result = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c00), _mm_set1_ps((1.0f - fx) * (1.0f - fy))),
+                       _mm_mul_ps(_mm_loadu_ps(c10), _mm_set1_ps(fx * (1.0f - fy)))),
+            _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c01), _mm_set1_ps((1.0f - fx) * fy)),
+                       _mm_mul_ps(_mm_loadu_ps(c11), _mm_set1_ps(fx * fy))));
+        alignas(16) float channels[4];
+        _mm_store_ps(channels, result);
+#else
+        float channels[3];
+        for (int k = 0; k < 3; ++k) {
+            channels[k] = c00[k] * (1.0f - fx) * (1.0f - fy) + c10[k] * fx * (1.0f - fy) +
+                          c01[k] * (1.0f - fx) * fy + c11[k] * fx * fy;
         }
+#endif
+        *windX = channels[0];
+        *windY = channels[1];
+        *density = channels[2];
     }
 
-    float x, y;
-    float speed;
-    float velocityX = 0.0f;
-    float velocityY = 0.0f;
-    bool isActive = true;
+    bool loaded = false;
+    int cols = 0, rows = 0;
+    float cellSize = 1.0f;
+    int frameCount = 0;
+    float frameDuration = 1.0f;
+    std::vector<float> frames;  // frameCount * rows * cols * (u, v, density, pad)
+    std::vector<float> current; // Blended frame used for sampling
 };
 
-// Function declarations
-void updateEntities(float deltaTime);
-void drawEntities();
-void launchMissile(float startX, float startY, std::shared_ptr<EnemyTarget> target); // No mutex lock inside
-void detectionTask();
-void drawDetectionRange();
-void drawPredictedTrajectory(const EnemyTarget& target);
+WindField windField;
 
-int main() {
-    // Initialize Allegro
-    if (!al_init()) {
-        std::cerr << "Failed to initialize Allegro!" << std::endl;
-        return -1;
-    }
+// Per-entity environment samples for one kinematics pass
+struct EnvironmentSamples {
+    Vec2Batch wind;
+    FloatArray density;
+};
 
-    // Initialize addons
-    if (!al_init_primitives_addon()) {
-        std::cerr << "Failed to initialize primitives addon!" << std::endl;
-        return -1;
+// Sample the wind field at every position in one batch; without a loaded
+// field the samples are calm air at unit density
+void sampleEnvironment(const Vec2Batch& positions, EnvironmentSamples& samples) {
+    size_t count = positions.size();
+    if (!windField.isLoaded()) {
+        samples.wind.x.assign(count, 0.0f);
+        samples.wind.y.assign(count, 0.0f);
+        samples.density.assign(count, 1.0f);
+        return;
     }
-    if (!al_install_keyboard()) {
-        std::cerr << "Failed to initialize keyboard!" << std::endl;
-        return -1;
+    samples.wind.resize(count);
+    samples.density.resize(count);
+    windField.sample(positions.x.data(), positions.y.data(), static_cast<int>(count),
+                     samples.wind.x.data(), samples.wind.y.data(), samples.density.data());
+}
+
+// NumaTopology class definition
+// CPUs of each memory node, read from /sys/devices/system/node. Machines
+// without that directory look like a single node holding every CPU.
+class NumaTopology {
+public:
+    explicit NumaTopology(const std::vector<std::vector<int>>& nodeCpus) : nodeCpus(nodeCpus) {
+        for (size_t node = 0; node < nodeCpus.size(); ++node) {
+            for (int cpu : nodeCpus[node]) {
+                if (cpu >= static_cast<int>(cpuNode.size())) cpuNode.resize(cpu + 1, 0);
+                cpuNode[cpu] = static_cast<int>(node);
+            }
+        }
     }
-    if (!al_install_mouse()) {
-        std::cerr << "Failed to initialize mouse!" << std::endl;
-        return -1;
+
+    static NumaTopology detect() {
+        std::vector<std::vector<int>> nodes;
+        for (int node : parseList(readLine("/sys/devices/system/node/online"))) {
+            std::vector<int> cpus = parseList(readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+            if (!cpus.empty()) nodes.push_back(cpus); // Memory-only nodes get no workers
+        }
+        return nodes.empty() ? singleNode() : NumaTopology(nodes);
     }
-    al_init_font_addon();
-    al_init_ttf_addon();
 
-    // Create display
-    ALLEGRO_DISPLAY* display = al_create_display(static_cast<int>(SCREEN_WIDTH), static_cast<int>(SCREEN_HEIGHT));
-    if (!display) {
-        std::cerr << "Failed to create display!" << std::endl;
-        return -1;
+    static NumaTopology singleNode() {
+        std::vector<std::vector<int>> nodes(1);
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+            nodes[0].push_back(static_cast<int>(cpu));
+        }
+        return NumaTopology(nodes);
     }
 
-    // Load font
-    ALLEGRO_FONT* font = al_create_builtin_font();
-    if (!font) {
-        std::cerr << "Failed to create font!" << std::endl;
-        al_destroy_display(display);
-        return -1;
+    int nodeCount() const { return static_cast<int>(nodeCpus.size()); }
+    const std::vector<int>& cpus(int node) const { return nodeCpus[node]; }
+    int nodeOfCpu(int cpu) const { return cpu >= 0 && cpu < static_cast<int>(cpuNode.size()) ? cpuNode[cpu] : 0; }
+
+private:
+    static std::string readLine(const std::string& path) {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        return line;
     }
 
-    // Create event queue and timer
-    ALLEGRO_EVENT_QUEUE* event_queue = al_create_event_queue();
-    ALLEGRO_TIMER* timer = al_create_timer(1.0 / FPS);
+    // Kernel list format: "0-3,8,10-11"
+    static std::vector<int> parseList(const std::string& text) {
+        std::vector<int> values;
+        std::istringstream in(text);
+        std::string range;
+        while (std::getline(in, range, ',')) {
+            int first = 0, last = 0;
+            if (std::sscanf(range.c_str(), "%d-%d", &first, &last) == 2) {
+                for (int v = first; v <= last; ++v) values.push_back(v);
+            } else if (std::sscanf(range.c_str(), "%d", &first) == 1) {
+                values.push_back(first);
+            }
+        }
+        return values;
+    }
 
-    // Register event sources
-    al_register_event_source(event_queue, al_get_display_event_source(display));
-    al_register_event_source(event_queue, al_get_timer_event_source(timer));
-    al_register_event_source(event_queue, al_get_keyboard_event_source());
-    al_register_event_source(event_queue, al_get_mouse_event_source());
+    std::vector<std::vector<int>> nodeCpus;
+    std::vector<int> cpuNode;
+};
 
-    // Start the timer
-    al_start_timer(timer);
+NumaTopology numaTopology = NumaTopology::detect();
 
-    // Initialize random seed
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
+// Entities per NUMA placement chunk. Chunk c of every entity array is placed
+// on, and updated by, node (c / numaChunkGroup()) % nodeCount (see numaFirstTouch).
+const int NUMA_CHUNK_ENTITIES = 16384;
 
-    // Main loop variables
-    bool running = true;
-    bool redraw = true;
+// Consecutive chunks that go to the same node. A huge page lives on a single
+// node, so once huge pages are on a node takes a whole 2 MB page of chunks;
+// with 64 KB groups the first node to touch a page would own all 32 of them.
+inline int numaChunkGroup() {
+    return HugePages::enabled() ? static_cast<int>(HUGE_PAGE_SIZE / (NUMA_CHUNK_ENTITIES * sizeof(float))) : 1;
+}
 
-    // Timers
-    float enemySpawnTimer = 0.0f;
-    const float enemySpawnInterval = 2.0f; // Spawn every 2 seconds
+// WorkerPool class definition
+// Fixed set of threads for data-parallel loops. The calling thread works on
+// chunks too, so a pool of zero workers runs everything inline. Calls from
+// several threads are serialized; a call from inside a loop body runs inline.
+// On a multi-node machine each worker is pinned to the CPUs of one node.
+class WorkerPool {
+public:
+    explicit WorkerPool(int workerCount, const NumaTopology& topology = NumaTopology::singleNode())
+        : topology(topology), nodeCursor(new std::atomic<int>[topology.nodeCount()]) {
+        // Spread workers over the nodes in proportion to their CPUs, skipping
+        // the first CPU, where the calling thread most likely runs
+        std::vector<int> cpuOrder;
+        for (int node = 0; node < topology.nodeCount(); ++node) {
+            for (int cpu : topology.cpus(node)) cpuOrder.push_back(cpu);
+        }
+        for (int i = 0; i < workerCount; ++i) {
+            int node = topology.nodeOfCpu(cpuOrder[(i + 1) % cpuOrder.size()]);
+            workers.emplace_back(&WorkerPool::run, this, node);
+            if (topology.nodeCount() > 1) pinToNode(workers.back(), node);
+        }
+    }
 
-    float detectionTimer = 0.0f;
-    const float detectionInterval = 0.5f; // Check every 0.5 seconds
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
 
-    while (running) {
-        ALLEGRO_EVENT ev;
-        al_wait_for_event(event_queue, &ev);
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+    int nodeCount() const { return topology.nodeCount(); }
 
-        if (ev.type == ALLEGRO_EVENT_TIMER) {
-            // Update simulation
-            float deltaTime = 1.0f / FPS;
+    // Call body(begin, end) over [0, count) in chunks of grain; returns once every chunk is done
+    void parallelFor(int count, int grain, const std::function<void(int, int)>& body) {
+        runLoop(count, grain, false, body);
+    }
 
-            // Update enemy spawn timer
-            enemySpawnTimer += deltaTime;
-            if (enemySpawnTimer >= enemySpawnInterval) {
-                enemySpawnTimer -= enemySpawnInterval;
+    // Call body(chunk, chunk + 1) for every chunk in [0, chunkCount), running
+    // chunk c on a thread of node (c / group) % nodeCount. The caller takes its
+    // own node's chunks and then any left over, so a node without workers still
+    // finishes. On one node this is parallelFor with a grain of one.
+    void parallelForNodes(int chunkCount, const std::function<void(int, int)>& body, int group = 1) {
+        runLoop(chunkCount, 1, topology.nodeCount() > 1, body, group);
+    }
 
-                // Spawn a new enemy target from the left edge
-                float startX = 0.0f;
-                float startY = static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT));
-                float speedX = 50.0f + static_cast<float>(std::rand() % 50); // Random speed between 50 and 100
-                float speedY = 0.0f;
+    static bool insideLoop() { return loopDepth() > 0; }
 
-                {
-                    std::lock_guard<std::mutex> lock(dataMutex);
-                    enemyTargets.emplace_back(std::make_shared<EnemyTarget>(startX, startY, speedX, speedY));
-                }
-            }
+private:
+    static int& loopDepth() {
+        thread_local int depth = 0;
+        return depth;
+    }
 
-            // Update detection timer
-            detectionTimer += deltaTime;
-            if (detectionTimer >= detectionInterval) {
-                detectionTimer -= detectionInterval;
-                detectionTask();
-            }
+    static void pinToNode(std::thread& thread, const std::vector<int>& cpus) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) CPU_SET(cpu, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)cpus;
+#endif
+    }
 
-            // Update entities
-            updateEntities(deltaTime);
+    static int currentCpu() {
+#ifdef __linux__
+        return sched_getcpu();
+#else
+        return -1; // Reads as node 0
+#endif
+    }
+    void pinToNode(std::thread& thread, int node) { pinToNode(thread, topology.cpus(node)); }
 
-            redraw = true;
+    void runLoop(int count, int grain, bool byNode, const std::function<void(int, int)>& body, int group = 1) {
+        if (count <= 0) return;
+        if (workers.empty() || count <= grain || insideLoop()) {
+            ++loopDepth();
+            body(0, count);
+            --loopDepth();
+            return;
         }
-        else if (ev.type == ALLEGRO_EVENT_DISPLAY_CLOSE) {
-            running = false;
+        std::lock_guard<std::mutex> callLock(callMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &body;
+            jobCount = count;
+            jobGrain = grain;
+            jobByNode = byNode;
+            jobGroup = group;
+            nextIndex = 0;
+            for (int node = 0; node < topology.nodeCount(); ++node) nodeCursor[node] = 0;
+            busyWorkers = static_cast<int>(workers.size());
+            ++generation;
         }
-        else if (ev.type == ALLEGRO_EVENT_KEY_DOWN) {
-            if (ev.keyboard.keycode == ALLEGRO_KEY_ESCAPE)
-                running = false;
-            else if (ev.keyboard.keycode == ALLEGRO_KEY_SPACE) {
-                // Launch missile toward the first enemy target
-                {
-                    std::lock_guard<std::mutex> lock(dataMutex);
-                    if (!enemyTargets.empty()) {
-                        float missileStartX = SCREEN_WIDTH; // Launch from the right edge
-                        float missileStartY = SCREEN_HEIGHT / 2.0f; // Middle of the screen
-                        auto target = enemyTargets.front();
-                        launchMissile(missileStartX, missileStartY, target);
-                    }
-                }
+        wake.notify_all();
+        runChunks(topology.nodeOfCpu(currentCpu()));
+        for (int node = 0; byNode && node < topology.nodeCount(); ++node) runChunks(node);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+    void run(int node) {
+        long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            runChunks(node);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0) finished.notify_one();
             }
         }
+    }
 
-        if (redraw && al_is_event_queue_empty(event_queue)) {
-            redraw = false;
-
-            // Clear screen
-            al_clear_to_color(al_map_rgb(0, 0, 0));
+    void runChunks(int node) {
+        ++loopDepth();
+        while (true) {
+            int begin;
+            if (jobByNode) {
+                // The node's k-th chunk: group k / jobGroup of its groups, then k % jobGroup within it
+                int k = nodeCursor[node].fetch_add(1);
+                begin = ((k / jobGroup) * topology.nodeCount() + node) * jobGroup + k % jobGroup;
+            } else {
+                begin = nextIndex.fetch_add(jobGrain);
+            }
+            if (begin >= jobCount) break;
+            (*job)(begin, std::min(begin + jobGrain, jobCount));
+        }
+        --loopDepth();
+    }
 
-            // Draw entities
-            drawEntities();
+    NumaTopology topology;
+    std::mutex callMutex; // One loop at a time
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    const std::function<void(int, int)>* job = nullptr;
+    int jobCount = 0;
+    int jobGrain = 1;
+    bool jobByNode = false;
+    int jobGroup = 1;
+    std::atomic<int> nextIndex{0};
+    std::unique_ptr<std::atomic<int>[]> nodeCursor; // Count of chunks each node has claimed
+    int busyWorkers = 0;
+    long generation = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers; // Declared last so they start after the state above exists
+};
 
-            // Draw HUD
-            al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 10, 0, "Targets: %zu", enemyTargets.size());
-            al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 30, 0, "Missiles: %zu", defenseMissiles.size());
-            al_draw_text(font, al_map_rgb(255, 255, 255), 10, 50, 0, "Press SPACE to manually launch a missile.");
+WorkerPool workerPool(std::max(1, static_cast<int>(std::thread::hardware_concurrency())) - 1, numaTopology);
 
-            // Flip display
-            al_flip_display();
-        }
+// Fraction of an entity array's pages that sit on the node whose workers
+// update them, as reported by move_pages; -1 if the kernel cannot tell.
+// Arrays in a huge-page mapping are checked once per 2 MB page.
+double localPageShare(const float* data, size_t count) {
+#ifndef __linux__
+    (void)data;
+    (void)count;
+    return -1.0;
+#else
+    const size_t pageSize = HugePages::isMapped(data) ? HUGE_PAGE_SIZE : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t groupBytes = NUMA_CHUNK_ENTITIES * sizeof(float) * numaChunkGroup();
+    std::vector<void*> pages;
+    std::vector<int> owner;
+    for (size_t offset = 0; offset < count * sizeof(float); offset += pageSize) {
+        pages.push_back(const_cast<char*>(reinterpret_cast<const char*>(data)) + offset);
+        owner.push_back(static_cast<int>((offset / groupBytes) % numaTopology.nodeCount()));
     }
+    std::vector<int> status(pages.size(), -1);
+    if (pages.empty() || syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0) {
+        return -1.0;
+    }
+    size_t local = 0;
+    for (size_t i = 0; i < pages.size(); ++i) local += status[i] == owner[i] ? 1 : 0;
+    return static_cast<double>(local) / pages.size();
+#endif
+}
 
-    // Clean up
-    al_destroy_font(font);
-    al_destroy_timer(timer);
-    al_destroy_event_queue(event_queue);
-    al_destroy_display(display);
-
-    return 0;
+// Place a fresh entity array the way parallelForNodes will update it: each
+// node's workers zero their own chunks first, so the kernel gives those pages
+// to that node. Installed as the FirstTouchHook on multi-node machines.
+void numaFirstTouch(void* memory, size_t bytes) {
+    if (WorkerPool::insideLoop()) return; // Allocated by a loop body; the pool is busy
+    const size_t chunkBytes = NUMA_CHUNK_ENTITIES * sizeof(float);
+    int chunks = static_cast<int>((bytes + chunkBytes - 1) / chunkBytes);
+    workerPool.parallelForNodes(chunks, [&](int begin, int end) {
+        for (int chunk = begin; chunk < end; ++chunk) {
+            size_t offset = chunk * chunkBytes;
+            std::memset(static_cast<char*>(memory) + offset, 0, std::min(chunkBytes, bytes - offset));
+        }
+    }, numaChunkGroup());
 }
 
-// Function implementations
+// Kinematic state of every live target in structure-of-arrays form. Slot i
+// belongs to enemyTargets[i]; updateEntities keeps the two aligned when it
+// compacts out inactive targets.
+struct TargetStore {
+    Vec2Batch position, velocity;
+    ByteArray active;
 
-// Update all entities
-void updateEntities(float deltaTime) {
-    std::lock_guard<std::mutex> lock(dataMutex);
+    size_t size() const { return active.size(); }
+    size_t capacity() const { return active.capacity(); } // Every array grows in step
+    void reserve(size_t count) { position.reserve(count); velocity.reserve(count); active.reserve(count); }
+    void resize(size_t count) { position.resize(count); velocity.resize(count); active.resize(count); }
+    void push(const Vec2& p, const Vec2& v) { position.push_back(p); velocity.push_back(v); active.push_back(1); }
+    void move(size_t from, size_t to) { position.move(from, to); velocity.move(from, to); active[to] = active[from]; }
+};
 
-    // Update enemy targets
-    for (auto& target : enemyTargets) {
-        target->update(deltaTime);
-    }
+// Kinematic and motor state of every live missile, slot i belongs to defenseMissiles[i]
+struct MissileStore {
+    Vec2Batch position, velocity;
+    FloatArray speed;
+    FloatArray flightTime; // Seconds since launch, drives the thrust curve
+    ByteArray active;
 
-    // Update defense missiles
-    for (auto& missile : defenseMissiles) {
-        missile->update(deltaTime);
+    size_t size() const { return active.size(); }
+    size_t capacity() const { return active.capacity(); } // Every array grows in step
+    void reserve(size_t count) {
+        position.reserve(count); velocity.reserve(count);
+        speed.reserve(count); flightTime.reserve(count); active.reserve(count);
+    }
+    void resize(size_t count) {
+        position.resize(count); velocity.resize(count);
+        speed.resize(count); flightTime.resize(count); active.resize(count);
+    }
+    void push(const Vec2& p, const Vec2& v, float launchSpeed) {
+        position.push_back(p); velocity.push_back(v);
+        speed.push_back(launchSpeed); flightTime.push_back(0.0f); active.push_back(1);
+    }
+    void move(size_t from, size_t to) {
+        position.move(from, to); velocity.move(from, to);
+        speed[to] = speed[from]; flightTime[to] = flightTime[from]; active[to] = active[from];
     }
+};
 
-    // Collision detection: Mark missiles and targets as inactive upon collision
-    for (auto& missile : defenseMissiles) {
-        if (!missile->isActiveMissile()) continue;
+TargetStore targetStore;
+MissileStore missileStore;
+
+// Engine statistics. Every thread counts into its own cache-line sized slot,
+// so parallel phases never write a shared line; endPhase() folds the slots
+// into the totals in registration order once the phase's loops have joined.
+// Entity IDs are not handed out here: entities are only created under
+// dataMutex, so a plain counter numbers them in creation order.
+enum Stat { STAT_KILLS, STAT_LEAKS, STAT_LAUNCHES, STAT_REJECTED_TARGETS, STAT_COUNT };
 
-        if (auto targetPtr = missile->target.lock()) {
-            if (!targetPtr->isActiveTarget()) continue;
+struct StatValues {
+    long values[STAT_COUNT] = {};
+    long operator[](Stat stat) const { return values[stat]; }
+};
+
+// EngineStats class definition
+class EngineStats {
+public:
+    void add(Stat stat, long amount = 1) { localSlot().counts.values[stat] += amount; }
 
-            float dx = missile->getX() - targetPtr->getX();
-            float dy = missile->getY() - targetPtr->getY();
-            if ((dx * dx + dy * dy) < 225) { // Collision radius of 15 units
-                missile->setInactive();
-                targetPtr->setInactive();
-                // No need to break, as missile can only have one target
+    // Sums and clears every thread's counts, adds them to the totals and
+    // returns them. No thread may count concurrently: call between loops,
+    // under the lock that guards the counting code.
+    const StatValues& endPhase() {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        phase = StatValues();
+        for (auto& slot : slots) {
+            for (int stat = 0; stat < STAT_COUNT; ++stat) {
+                phase.values[stat] += slot.counts.values[stat];
+                slot.counts.values[stat] = 0;
             }
         }
+        for (int stat = 0; stat < STAT_COUNT; ++stat) totals.values[stat] += phase.values[stat];
+        return phase;
     }
 
-    // Remove inactive targets
-    enemyTargets.erase(
-        std::remove_if(enemyTargets.begin(), enemyTargets.end(),
-                       [](const std::shared_ptr<EnemyTarget>& target) { return !target->isActiveTarget(); }),
-        enemyTargets.end());
-
-    // Remove inactive missiles
-    defenseMissiles.erase(
-        std::remove_if(defenseMissiles.begin(), defenseMissiles.end(),
-                       [](const std::shared_ptr<DefenseMissile>& missile) { return !missile->isActiveMissile(); }),
-        defenseMissiles.end());
-}
-
-// Draw all entities
-void drawEntities() {
-    // Draw detection range
-    drawDetectionRange();
+    long total(Stat stat) const { return totals[stat]; }
 
-    std::lock_guard<std::mutex> lock(dataMutex);
+private:
+    struct alignas(64) Slot {
+        StatValues counts;
+        std::thread::id owner;
+    };
 
-    // Draw enemy targets and their predicted trajectories
-    for (const auto& target : enemyTargets) {
-        target->draw();
-        drawPredictedTrajectory(*target);
+    // This thread's slot, found again by thread ID if the thread has been
+    // counting into another EngineStats in between
+    Slot& localSlot() {
+        thread_local long cachedOwner = -1;
+        thread_local Slot* cachedSlot = nullptr;
+        if (cachedOwner != serial) {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            std::thread::id self = std::this_thread::get_id();
+            cachedSlot = nullptr;
+            for (auto& slot : slots) {
+                if (slot.owner == self) cachedSlot = &slot;
+            }
+            if (!cachedSlot) {
+                slots.emplace_back();
+                cachedSlot = &slots.back();
+                cachedSlot->owner = self;
+            }
+            cachedOwner = serial;
+        }
+        return *cachedSlot;
     }
 
-    // Draw defense missiles
-    for (const auto& missile : defenseMissiles) {
-        missile->draw();
+    static long nextSerial() {
+        static std::atomic<long> counter{0};
+        return counter++;
     }
-}
 
-// Launch a missile towards a target
-void launchMissile(float startX, float startY, std::shared_ptr<EnemyTarget> target) {
-    // Assume dataMutex is locked by the caller
-    float missileSpeed = 200.0f; // Adjust as needed
-    defenseMissiles.emplace_back(std::make_shared<DefenseMissile>(startX, startY, target, missileSpeed));
-}
+    const long serial = nextSerial(); // Unlike the address, never reused by a later instance
+    std::mutex slotMutex;             // Guards slots; counting itself never takes it
+    std::deque<Slot, AlignedAllocator<Slot>> slots; // A deque keeps cached slot pointers valid
+    StatValues phase, totals;
+};
 
-// Detection task to detect targets within range and launch missiles
-void detectionTask() {
-    std::lock_guard<std::mutex> lock(dataMutex);
+EngineStats engineStats;
 
-    float detectionRange = 500.0f; // Adjust as needed
-    float sensorX = SCREEN_WIDTH; // Sensor location at the right edge
-    float sensorY = SCREEN_HEIGHT / 2.0f;
+// EnemyTarget class definition
+// Handle to one target; its kinematic state lives in targetStore at slot.
+class EnemyTarget {
+public:
+    explicit EnemyTarget(int slot) : slot(slot), id(nextID++) {}
 
-    for (const auto& target : enemyTargets) {
-        float dx = target->getX() - sensorX;
-        float dy = target->getY() - sensorY;
-        float distance = std::sqrt(dx * dx + dy * dy);
-        if (distance <= detectionRange) {
-            // Target detected, launch missile
-            launchMissile(sensorX, sensorY, target);
-            // For simplicity, break after launching at one target
-            break;
-        }
+    void draw() const {
+        al_draw_filled_circle(getX(), getY(), 10, al_map_rgb(255, 0, 0));
     }
-}
 
-// Draw the detection range
-void drawDetectionRange() {
-    float sensorX = SCREEN_WIDTH; // Sensor location at the right edge
-    float sensorY = SCREEN_HEIGHT / 2.0f;
-    float detectionRange = 500.0f;
+    float getX() const { return targetStore.position.x[slot]; }
+    float getY() const { return targetStore.position.y[slot]; }
+    Vec2 getPosition() const { return targetStore.position.get(slot); }
+    Vec2 getVelocity() const { return targetStore.velocity.get(slot); }
+    bool isActiveTarget() const { return slot >= 0 && targetStore.active[slot]; }
+    void setInactive() { targetStore.active[slot] = 0; }
 
-    al_draw_circle(sensorX, sensorY, detectionRange, al_map_rgb(0, 0, 255), 1);
-}
+    int getID() const { return id; }
+    int getSlot() const { return slot; }
+    void setSlot(int newSlot) { slot = newSlot; }
 
-// Draw predicted trajectory of an enemy target
-void drawPredictedTrajectory(const EnemyTarget& target) {
-    float predictionTime = 5.0f; // Predict 5 seconds into the future
+    SensorFootprint footprint; // Attacker-side coverage, maintained in updateEntities
+    int trailSlot = -1;        // Slot in targetTrails, -1 if none
+    bool rejected = false;     // Passed over as out of reach by detectionTask at least once
+
+private:
+    int slot; // -1 once removed from the world
+    int id;
+    static int nextID; // Guarded by dataMutex, like every spawn
+};
+
+int EnemyTarget::nextID = 0;
+
+// Missile aerodynamics and motor curves. The reference curves are written
+// with constexpr-friendly arithmetic only, so the same functions generate
+// the lookup tables at compile time and serve as the analytic reference.
+const float SPEED_OF_SOUND = 340.0f;    // Units per second
+const float MISSILE_DRAG_AREA = 0.004f; // Reference area over mass
+const float KILL_RADIUS = 15.0f; // Missile-to-target distance that counts as an intercept
+const float MISSILE_LAUNCH_SPEED = 200.0f; // Off the rail; the motor and drag take over from here
+const float MISSILE_MIN_SPEED = 60.0f;  // Below this the missile self-destructs
+
+constexpr float smoothStep(float edge0, float edge1, float x) {
+    float t = (x - edge0) / (edge1 - edge0);
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Drag coefficient against Mach number: flat subsonic, transonic peak near Mach 1.05
+constexpr float dragCoefficientReference(float mach) {
+    float offset = (mach - 1.05f) / 0.25f;
+    return 0.25f + 0.45f / (1.0f + offset * offset);
+}
+
+// Thrust over mass against time since launch: boost, sustain, then burnout
+constexpr float thrustReference(float seconds) {
+    return 200.0f * (1.0f - smoothStep(0.4f, 0.6f, seconds)) +
+           52.0f * smoothStep(0.4f, 0.6f, seconds) * (1.0f - smoothStep(2.8f, 3.2f, seconds));
+}
+
+// Uniformly sampled curve with linear interpolation; inputs clamp to the range
+template <int N>
+struct CurveTable {
+    float minX, maxX, invStep;
+    float values[N];
+
+    constexpr float operator()(float x) const {
+        float position = (x - minX) * invStep;
+        position = position < 0.0f ? 0.0f : (position > N - 1.001f ? N - 1.001f : position);
+        int index = static_cast<int>(position);
+        float fraction = position - index;
+        return values[index] + (values[index + 1] - values[index]) * fraction;
+    }
+};
+
+template <int N>
+constexpr CurveTable<N> makeCurveTable(float (*curve)(float), float minX, float maxX) {
+    CurveTable<N> table{minX, maxX, (N - 1) / (maxX - minX), {}};
+    for (int i = 0; i < N; ++i) {
+        table.values[i] = curve(minX + (maxX - minX) * i / (N - 1));
+    }
+    return table;
+}
+
+// Largest absolute table error over a dense sweep of its range
+template <int N>
+constexpr float maxCurveTableError(const CurveTable<N>& table, float (*curve)(float), int samples) {
+    float worst = 0.0f;
+    for (int i = 0; i <= samples; ++i) {
+        float x = table.minX + (table.maxX - table.minX) * i / samples;
+        float error = table(x) - curve(x);
+        error = error < 0.0f ? -error : error;
+        worst = error > worst ? error : worst;
+    }
+    return worst;
+}
+
+constexpr CurveTable<256> DRAG_TABLE = makeCurveTable<256>(&dragCoefficientReference, 0.0f, 4.0f);
+constexpr CurveTable<256> THRUST_TABLE = makeCurveTable<256>(&thrustReference, 0.0f, 4.0f);
+
+// Within 1% of the transonic drag peak and 0.5% of boost thrust
+static_assert(maxCurveTableError(DRAG_TABLE, &dragCoefficientReference, 4096) < 7e-3f,
+              "drag table deviates from the reference curve");
+static_assert(maxCurveTableError(THRUST_TABLE, &thrustReference, 4096) < 1.0f,
+              "thrust table deviates from the reference curve");
+
+// Advance missile speed by one step of motor thrust against drag
+inline float missileSpeedStep(float speed, float flightTime, float airDensity, float deltaTime) {
+    float drag = 0.5f * airDensity * speed * speed * DRAG_TABLE(speed / SPEED_OF_SOUND) * MISSILE_DRAG_AREA;
+    return std::max(speed + (THRUST_TABLE(flightTime) - drag) * deltaTime, 0.0f);
+}
+
+// Pure-pursuit guidance: velocity of the given speed along offset. Leaves
+// the velocity unchanged when the target is practically on top of the missile.
+template <typename Math>
+inline void pursuitVelocity(const Vec2& offset, float speed, Vec2& velocity) {
+    float distanceSq = offset.lengthSquared();
+    if (distanceSq > 0.0001f) { // Use a small epsilon to avoid division by zero
+        velocity = offset * (Math::rsqrt(distanceSq) * speed);
+    }
+}
+
+// Outcome of one scripted missile-versus-target engagement
+struct InterceptOutcome {
+    bool hit = false;
+    float time = 0.0f; // Seconds to intercept, or until the missile gave up
+};
+
+// Fly one missile from launchPoint against one constant-velocity target in
+// calm air with the engine's guidance and speed model, using the given math
+template <typename Math>
+InterceptOutcome simulateIntercept(const Vec2& launchPoint, const Vec2& target, const Vec2& targetVelocity) {
+    const float deltaTime = 1.0f / FPS;
+    Vec2 position = launchPoint, velocity;
+    Vec2 targetPosition = target;
+    float speed = MISSILE_LAUNCH_SPEED, flightTime = 0.0f;
+
+    InterceptOutcome outcome;
+    while (flightTime < 10.0f && speed >= MISSILE_MIN_SPEED) {
+        speed = missileSpeedStep(speed, flightTime, 1.0f, deltaTime);
+        flightTime += deltaTime;
+        pursuitVelocity<Math>(targetPosition - position, speed, velocity);
+        position += velocity * deltaTime;
+        targetPosition += targetVelocity * deltaTime;
+        if ((position - targetPosition).lengthSquared() < KILL_RADIUS * KILL_RADIUS) {
+            outcome.hit = true;
+            break;
+        }
+    }
+    outcome.time = flightTime;
+    return outcome;
+}
+
+// Whether a constant-velocity target is still short of the defended edge
+// (x = SCREEN_WIDTH), where it leaks and leaves the world, after seconds
+inline bool beforeLeak(const Vec2& target, const Vec2& targetVelocity, float seconds) {
+    return target.x + targetVelocity.x * seconds < SCREEN_WIDTH;
+}
+
+// LaunchTable class definition
+// Launch acceptability region: whether a missile fired now can reach the
+// target, precomputed by simulating the engagement at every node of a grid
+// over line-of-sight range, target radial velocity (positive is opening)
+// and crossing speed. A query rotates the geometry into the line-of-sight
+// frame and reads the nearest node, so feasibility costs O(1) instead of a
+// simulated flight.
+class LaunchTable {
+public:
+    static const int RANGE_NODES = 41;   // 0..1000 units
+    static const int RADIAL_NODES = 17;  // -160..160 units/s
+    static const int CROSSING_NODES = 9; // 0..160 units/s
+    static constexpr float MAX_RANGE = 1000.0f;
+    static constexpr float MAX_SPEED = 160.0f;
+
+    void build() {
+        nodes.resize(RANGE_NODES * RADIAL_NODES * CROSSING_NODES);
+        for (int r = 0; r < RANGE_NODES; ++r) {
+            for (int v = 0; v < RADIAL_NODES; ++v) {
+                for (int c = 0; c < CROSSING_NODES; ++c) {
+                    Vec2 target(r * RANGE_STEP, 0.0f);
+                    Vec2 velocity(-MAX_SPEED + v * RADIAL_STEP, c * CROSSING_STEP);
+                    InterceptOutcome outcome = simulateIntercept<ExactMath>(Vec2(), target, velocity);
+                    nodes[index(r, v, c)] = outcome.hit ? outcome.time : -1.0f;
+                }
+            }
+        }
+    }
+
+    bool isBuilt() const { return !nodes.empty(); }
+
+    // Predicted time to intercept, or a negative value if the shot cannot connect
+    float interceptTime(const Vec2& launchPoint, const Vec2& target, const Vec2& targetVelocity) const {
+        Vec2 lineOfSight = target - launchPoint;
+        float rangeSq = lineOfSight.lengthSquared();
+        if (rangeSq >= MAX_RANGE * MAX_RANGE) return -1.0f;
+        float radial = 0.0f, crossing = 0.0f; // On top of the launcher any geometry hits
+        if (rangeSq > 0.0001f) {
+            Vec2 unit = lineOfSight * EngineMath::rsqrt(rangeSq);
+            radial = targetVelocity.dot(unit);
+            crossing = std::fabs(unit.cross(targetVelocity));
+        }
+        int r = nearestNode(std::sqrt(rangeSq) / RANGE_STEP, RANGE_NODES);
+        int v = nearestNode((radial + MAX_SPEED) / RADIAL_STEP, RADIAL_NODES);
+        int c = nearestNode(crossing / CROSSING_STEP, CROSSING_NODES);
+        return nodes[index(r, v, c)];
+    }
+
+    // Whether a missile fired now connects before the target leaks past the defended edge
+    bool feasible(const Vec2& launchPoint, const Vec2& target, const Vec2& targetVelocity) const {
+        float time = interceptTime(launchPoint, target, targetVelocity);
+        return time >= 0.0f && beforeLeak(target, targetVelocity, time);
+    }
+
+private:
+    static constexpr float RANGE_STEP = MAX_RANGE / (RANGE_NODES - 1);
+    static constexpr float RADIAL_STEP = 2.0f * MAX_SPEED / (RADIAL_NODES - 1);
+    static constexpr float CROSSING_STEP = MAX_SPEED / (CROSSING_NODES - 1);
+
+    static int index(int r, int v, int c) { return (r * RADIAL_NODES + v) * CROSSING_NODES + c; }
+
+    static int nearestNode(float position, int count) {
+        return std::min(std::max(static_cast<int>(position + 0.5f), 0), count - 1);
+    }
+
+    std::vector<float> nodes; // Intercept time per node, -1 where the missile never connects
+};
+
+LaunchTable launchTable;
+
+// DefenseMissile class definition
+// Handle to one missile; its kinematic state lives in missileStore at slot.
+class DefenseMissile {
+public:
+    DefenseMissile(int slot, std::shared_ptr<EnemyTarget> target)
+        : target(target), slot(slot), id(nextID++) {
+        aimAtTarget();
+    }
+
+    void draw() const {
+        al_draw_filled_circle(getX(), getY(), 5, al_map_rgb(0, 255, 0));
+    }
+
+    float getX() const { return missileStore.position.x[slot]; }
+    float getY() const { return missileStore.position.y[slot]; }
+    Vec2 getPosition() const { return missileStore.position.get(slot); }
+    bool isActiveMissile() const { return slot >= 0 && missileStore.active[slot]; }
+    void setInactive() { missileStore.active[slot] = 0; }
+
+    int getID() const { return id; }
+    int getSlot() const { return slot; }
+    void setSlot(int newSlot) { slot = newSlot; }
+
+    // Point the missile at a new target (manual retarget from the selection UI)
+    void retarget(std::shared_ptr<EnemyTarget> newTarget) {
+        target = newTarget;
+        aimAtTarget();
+    }
+
+    std::weak_ptr<EnemyTarget> target; // Make target public to access in collision detection
+    int trailSlot = -1;                // Slot in missileTrails, -1 if none
+
+private:
+    void aimAtTarget() {
+        if (auto sharedTarget = target.lock()) {
+            Vec2 velocity = missileStore.velocity.get(slot);
+            pursuitVelocity<EngineMath>(sharedTarget->getPosition() - getPosition(), missileStore.speed[slot], velocity);
+            missileStore.velocity.set(slot, velocity);
+        }
+    }
+
+    int slot; // -1 once removed from the world
+    int id;
+    static int nextID; // Guarded by dataMutex, like every launch
+};
+
+int DefenseMissile::nextID = 0;
+
+// Metrics for long-running instances, scraped in Prometheus text format.
+// Updates go to one of SHARDS cache-line sized slots picked per thread, so
+// threads rarely touch the same line and never take a lock; a scrape sums
+// the slots, which is cheap and only happens a few times a minute.
+const int METRIC_SHARDS = 16;
+
+inline int metricShard() {
+    static std::atomic<int> nextShard{0};
+    thread_local int shard = nextShard.fetch_add(1) % METRIC_SHARDS;
+    return shard;
+}
+
+class Counter {
+public:
+    void add(uint64_t amount = 1) { shards[metricShard()].value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t value() const {
+        uint64_t sum = 0;
+        for (const auto& shard : shards) sum += shard.value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards[METRIC_SHARDS];
+};
+
+class Gauge {
+public:
+    void set(double newValue) { current.store(newValue, std::memory_order_relaxed); }
+    double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current{0.0};
+};
+
+// Cumulative-bucket histogram of seconds; the sum is kept in nanoseconds so
+// every slot is an integer counter
+class Histogram {
+public:
+    explicit Histogram(const std::vector<double>& bounds) : bounds(bounds), shards(METRIC_SHARDS) {
+        for (auto& shard : shards) shard.buckets.reset(new std::atomic<uint64_t>[bounds.size() + 1]());
+    }
+
+    void observe(double seconds) {
+        size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), seconds) - bounds.begin();
+        Shard& shard = shards[metricShard()];
+        shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        shard.nanoseconds.fetch_add(static_cast<uint64_t>(seconds * 1e9), std::memory_order_relaxed);
+    }
+
+    void write(std::ostream& out, const std::string& name) const {
+        uint64_t cumulative = 0, nanoseconds = 0;
+        for (size_t b = 0; b <= bounds.size(); ++b) {
+            for (const auto& shard : shards) cumulative += shard.buckets[b].load(std::memory_order_relaxed);
+            out << name << "_bucket{le=\"";
+            if (b < bounds.size()) out << bounds[b]; else out << "+Inf";
+            out << "\"} " << cumulative << "\n";
+        }
+        for (const auto& shard : shards) nanoseconds += shard.nanoseconds.load(std::memory_order_relaxed);
+        out << name << "_sum " << nanoseconds * 1e-9 << "\n" << name << "_count " << cumulative << "\n";
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<uint64_t> nanoseconds{0};
+    };
+    std::vector<double> bounds;
+    std::vector<Shard, AlignedAllocator<Shard>> shards; // std::allocator ignores alignas before C++17
+};
+
+// MetricsRegistry class definition
+// Owns every metric; registration happens once at startup, after which the
+// set of metrics is fixed and render() can run concurrently with updates.
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help) {
+        counters.emplace_back();
+        entries.push_back(Entry{name, help, "counter", &counters.back(), nullptr, nullptr});
+        return counters.back();
+    }
+    Gauge& gauge(const std::string& name, const std::string& help) {
+        gauges.emplace_back();
+        entries.push_back(Entry{name, help, "gauge", nullptr, &gauges.back(), nullptr});
+        return gauges.back();
+    }
+    Histogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds) {
+        histograms.emplace_back(bounds);
+        entries.push_back(Entry{name, help, "histogram", nullptr, nullptr, &histograms.back()});
+        return histograms.back();
+    }
+
+    std::string render() const {
+        std::ostringstream out;
+        for (const auto& entry : entries) {
+            out << "# HELP " << entry.name << " " << entry.help << "\n# TYPE " << entry.name << " " << entry.type << "\n";
+            if (entry.counter) out << entry.name << " " << entry.counter->value() << "\n";
+            if (entry.gauge) out << entry.name << " " << entry.gauge->value() << "\n";
+            if (entry.histogram) entry.histogram->write(out, entry.name);
+        }
+        return out.str();
+    }
+
+private:
+    struct Entry {
+        std::string name, help;
+        const char* type;
+        const Counter* counter;
+        const Gauge* gauge;
+        const Histogram* histogram;
+    };
+    std::deque<Counter, AlignedAllocator<Counter>> counters; // Deques keep handed-out references valid
+    std::deque<Gauge> gauges;
+    std::deque<Histogram> histograms;
+    std::vector<Entry> entries;
+};
+
+MetricsRegistry metrics;
+Counter& ticksTotal = metrics.counter("engine_ticks_total", "Simulation ticks completed");
+Histogram& tickSeconds = metrics.histogram("engine_tick_seconds", "Wall time per simulation tick",
+                                           {0.0005, 0.001, 0.002, 0.004, 0.008, 1.0 / FPS, 0.032, 0.064, 0.25});
+Gauge& targetsActive = metrics.gauge("engine_targets", "Enemy targets alive");
+Gauge& missilesInFlight = metrics.gauge("engine_missiles_in_flight", "Defense missiles in flight");
+Counter& killsTotal = metrics.counter("engine_kills_total", "Targets destroyed by missiles");
+Counter& leaksTotal = metrics.counter("engine_leaks_total", "Targets that reached the defended edge");
+Counter& launchesTotal = metrics.counter("engine_launches_total", "Defense missiles launched");
+Gauge& tickBacklog = metrics.gauge("engine_tick_backlog", "Timer ticks waiting to be simulated");
+Gauge& radarTracks = metrics.gauge("engine_radar_tracks", "Tracks held by the phased-array radar");
+Gauge& radarLoad = metrics.gauge("engine_radar_load", "Requested radar dwell time over the frame budget");
+
+// MetricsServer class definition
+// Serves the registry over HTTP on 127.0.0.1 (--metrics-port). Every
+// request gets the full text exposition; the thread polls so it can stop.
+// Only available on Linux; elsewhere start() fails.
+class MetricsServer {
+public:
+    ~MetricsServer() { stop(); }
+
+#ifndef __linux__
+    bool start(int) { return false; }
+    void stop() {}
+#else
+    bool start(int port) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0) return false;
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 8) != 0) {
+            close(listener);
+            listener = -1;
+            return false;
+        }
+        running = true;
+        thread = std::thread(&MetricsServer::run, this);
+        return true;
+    }
+
+    void stop() {
+        if (!running) return;
+        running = false;
+        thread.join();
+        close(listener);
+        listener = -1;
+    }
+
+private:
+    void run() {
+        while (running) {
+            pollfd waiting = {listener, POLLIN, 0};
+            if (poll(&waiting, 1, 200) <= 0) continue;
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) continue;
+
+            // The request itself does not matter; read what has arrived and answer
+            char request[1024];
+            pollfd readable = {client, POLLIN, 0};
+            if (poll(&readable, 1, 1000) > 0) recv(client, request, sizeof(request), 0);
+            std::string body = metrics.render();
+            std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                                   std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) break;
+                sent += static_cast<size_t>(n);
+            }
+            close(client);
+        }
+    }
+
+    int listener = -1;
+    std::atomic<bool> running{false};
+    std::thread thread;
+#endif
+};
+
+MetricsServer metricsServer;
+
+EventLog eventLog; // Opened by --event-log
+long simulationTick = 0; // Number of the tick in progress, guarded by dataMutex
+
+// Start the next tick before anything in it spawns, detects or launches, so
+// every event of one tick is logged with the same number
+void beginTick() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    ++simulationTick;
+    eventLog.setTick(simulationTick);
+}
+
+// NodePool class definition
+// Fixed-size nodes carved from blocks of BLOCK_NODES, so a batch of handles
+// costs one heap allocation per block instead of one per handle. Nodes are
+// taken only under dataMutex; the last reference to a handle may drop on
+// any thread, so returned nodes go onto a lock-free stack that take() claims
+// whole. Blocks are kept until exit and the pool itself is never destroyed,
+// since handles in the global entity lists outlive function statics.
+template <size_t Size, size_t Align>
+class NodePool {
+public:
+    static const size_t BLOCK_NODES = 1024;
+
+    static NodePool& instance() {
+        static NodePool* pool = new NodePool();
+        return *pool;
+    }
+
+    void* take() {
+        if (!freeList) freeList = returned.exchange(nullptr, std::memory_order_acquire);
+        if (!freeList) grow();
+        Node* node = freeList;
+        freeList = node->next;
+        return node;
+    }
+
+    void give(void* memory) {
+        Node* node = static_cast<Node*>(memory);
+        node->next = returned.load(std::memory_order_relaxed);
+        while (!returned.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+private:
+    union Node {
+        Node* next;
+        typename std::aligned_storage<Size, Align>::type storage;
+    };
+    static_assert(Align <= alignof(std::max_align_t), "new[] only guarantees fundamental alignment before C++17");
+
+    void grow() {
+        blocks.emplace_back(new Node[BLOCK_NODES]);
+        Node* block = blocks.back().get();
+        for (size_t i = 0; i + 1 < BLOCK_NODES; ++i) block[i].next = &block[i + 1];
+        block[BLOCK_NODES - 1].next = nullptr;
+        freeList = block;
+    }
+
+    Node* freeList = nullptr;
+    std::atomic<Node*> returned{nullptr};
+    std::vector<std::unique_ptr<Node[]>> blocks;
+};
+
+// Allocator for std::allocate_shared that puts each handle and its control
+// block in a NodePool node
+template <typename T>
+struct PoolAllocator {
+    typedef T value_type;
+
+    PoolAllocator() = default;
+    template <typename U> PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        if (count != 1) return static_cast<T*>(::operator new(count * sizeof(T)));
+        return static_cast<T*>(NodePool<sizeof(T), alignof(T)>::instance().take());
+    }
+    void deallocate(T* memory, size_t count) {
+        if (count != 1) ::operator delete(memory);
+        else NodePool<sizeof(T), alignof(T)>::instance().give(memory);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+// Create a target in the next store slot
+std::shared_ptr<EnemyTarget> addTarget(const Vec2& position, const Vec2& velocity) {
+    // Assume dataMutex is locked by the caller
+    targetStore.push(position, velocity);
+    enemyTargets.emplace_back(std::make_shared<EnemyTarget>(static_cast<int>(enemyTargets.size())));
+    eventLog.append(EVENT_SPAWN, enemyTargets.back()->getID(), -1, position.x, position.y);
+    return enemyTargets.back();
+}
+
+// Create a missile in the next store slot, aimed at its target
+std::shared_ptr<DefenseMissile> addMissile(const Vec2& position, std::shared_ptr<EnemyTarget> target, float launchSpeed) {
+    // Assume dataMutex is locked by the caller
+    missileStore.push(position, Vec2(), launchSpeed);
+    engineStats.add(STAT_LAUNCHES);
+    defenseMissiles.emplace_back(std::make_shared<DefenseMissile>(static_cast<int>(defenseMissiles.size()), target));
+    eventLog.append(EVENT_LAUNCH, defenseMissiles.back()->getID(), target ? target->getID() : -1, position.x, position.y);
+    return defenseMissiles.back();
+}
+
+// One target of a scripted spawn batch
+struct TargetSpawn {
+    Vec2 position;
+    Vec2 velocity;
+};
+
+// One round of a salvo: where it leaves from and what it flies at
+struct SalvoShot {
+    Vec2 launchPoint;
+    std::shared_ptr<EnemyTarget> target;
+};
+
+// Move every target one step with the wind, then retire targets that left the playfield
+void integrateTargets(float deltaTime, const EnvironmentSamples& environment) {
+    // Large raids update chunk by chunk, each on the NUMA node holding its pages
+    const int count = static_cast<int>(targetStore.size());
+    const int chunks = (count + NUMA_CHUNK_ENTITIES - 1) / NUMA_CHUNK_ENTITIES;
+    workerPool.parallelForNodes(chunks, [&](int firstChunk, int lastChunk) {
+        size_t begin = static_cast<size_t>(firstChunk) * NUMA_CHUNK_ENTITIES;
+        size_t end = std::min(static_cast<size_t>(lastChunk) * NUMA_CHUNK_ENTITIES, static_cast<size_t>(count));
+        integrate(targetStore.position, targetStore.velocity, environment.wind, deltaTime, begin, end);
+
+        const float* x = targetStore.position.x.data();
+        const float* y = targetStore.position.y.data();
+        for (size_t i = begin; i < end; ++i) {
+            if (x[i] > SCREEN_WIDTH || y[i] < 0 || y[i] > SCREEN_HEIGHT) {
+                targetStore.active[i] = 0;
+            }
+        }
+    }, numaChunkGroup());
+}
+
+// Advance every missile: motor and drag set the new speed, pure pursuit
+// re-aims at the target, and the position integrates with the wind. A missile
+// whose target is gone keeps flying along its current heading.
+void integrateMissiles(float deltaTime, const EnvironmentSamples& environment) {
+    static Vec2Batch aimPoint, offset;
+    size_t count = missileStore.size();
+    aimPoint.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        missileStore.speed[i] = missileSpeedStep(missileStore.speed[i], missileStore.flightTime[i],
+                                                 environment.density[i], deltaTime);
+        missileStore.flightTime[i] += deltaTime;
+
+        std::shared_ptr<EnemyTarget> target = defenseMissiles[i]->target.lock();
+        if (target && !target->isActiveTarget()) {
+            // Target is inactive, missile continues in current direction
+            defenseMissiles[i]->target.reset();
+            target.reset();
+        }
+        aimPoint.set(i, target ? target->getPosition()
+                               : missileStore.position.get(i) + missileStore.velocity.get(i));
+    }
+
+    // Guidance re-aims every tick, so wind drift shows up as a curved path
+    subtract(aimPoint, missileStore.position, offset);
+    scaleToLength(offset, missileStore.speed.data(), 0.01f, missileStore.velocity);
+    integrate(missileStore.position, missileStore.velocity, environment.wind, deltaTime);
+
+    // Remove missiles that went off-screen or bled off their energy
+    const float* x = missileStore.position.x.data();
+    const float* y = missileStore.position.y.data();
+    for (size_t i = 0; i < count; ++i) {
+        if (x[i] < 0 || x[i] > SCREEN_WIDTH || y[i] < 0 || y[i] > SCREEN_HEIGHT ||
+            missileStore.speed[i] < MISSILE_MIN_SPEED) {
+            missileStore.active[i] = 0;
+        }
+    }
+}
+
+// Slots of the active missiles within the kill radius of their live target, ascending
+void detectCollisions(std::vector<int>& hits) {
+    static Vec2Batch aimPoint;
+    static FloatArray distanceSq;
+    size_t count = missileStore.size();
+    aimPoint.resize(count);
+    distanceSq.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        std::shared_ptr<EnemyTarget> target = defenseMissiles[i]->target.lock();
+        if (missileStore.active[i] && target && target->isActiveTarget()) {
+            aimPoint.set(i, target->getPosition());
+        } else {
+            aimPoint.set(i, missileStore.position.get(i) + Vec2(2.0f * KILL_RADIUS, 0.0f)); // Never a hit
+        }
+    }
+    distanceSquared(missileStore.position, aimPoint, distanceSq.data());
+
+    hits.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (distanceSq[i] < KILL_RADIUS * KILL_RADIUS) hits.push_back(static_cast<int>(i));
+    }
+}
+
+// Drop inactive entities, keeping every store slot aligned with its handle
+template <typename Entity, typename Store>
+void compactEntities(std::vector<std::shared_ptr<Entity>>& entities, Store& store) {
+    size_t kept = 0;
+    for (size_t i = 0; i < entities.size(); ++i) {
+        if (!store.active[i]) {
+            entities[i]->setSlot(-1);
+            continue;
+        }
+        if (kept != i) {
+            entities[kept] = std::move(entities[i]);
+            store.move(i, kept);
+        }
+        entities[kept]->setSlot(static_cast<int>(kept));
+        ++kept;
+    }
+    entities.resize(kept);
+    store.resize(kept);
+}
+
+// TerrainGrid class definition
+// Movement cost per terrain cell for ground units: 1 is open ground, larger
+// values are slower terrain and IMPASSABLE blocks the cell entirely.
+class TerrainGrid {
+public:
+    static const unsigned char IMPASSABLE = 255;
+
+    TerrainGrid(float width, float height, float cellSize)
+        : cellSize(cellSize),
+          cols(static_cast<int>(std::ceil(width / cellSize))),
+          rows(static_cast<int>(std::ceil(height / cellSize))),
+          costs(cols * rows, 1) {}
+
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+    int getCellCount() const { return cols * rows; }
+    float getCellSize() const { return cellSize; }
+
+    int cellAt(float x, float y) const {
+        int cx = std::min(std::max(static_cast<int>(x / cellSize), 0), cols - 1);
+        int cy = std::min(std::max(static_cast<int>(y / cellSize), 0), rows - 1);
+        return cy * cols + cx;
+    }
+    float cellCenterX(int cell) const { return (cell % cols + 0.5f) * cellSize; }
+    float cellCenterY(int cell) const { return (cell / cols + 0.5f) * cellSize; }
+
+    unsigned char getCost(int cell) const { return costs[cell]; }
+    void setCost(int cell, unsigned char cost) { costs[cell] = cost; }
+    bool isPassable(int cell) const { return costs[cell] != IMPASSABLE; }
+
+private:
+    float cellSize;
+    int cols, rows;
+    std::vector<unsigned char> costs;
+};
+
+// FlowField class definition
+// Integration field towards one destination cell: cost-to-go per cell plus
+// the neighbour to step into next. One field is shared by every unit heading
+// to the same destination, so per-unit steering is a single lookup.
+class FlowField {
+public:
+    FlowField(const TerrainGrid& terrain, int destination)
+        : destination(destination),
+          integration(terrain.getCellCount(), INFINITE_COST),
+          next(terrain.getCellCount(), -1) {
+        if (terrain.isPassable(destination)) {
+            integration[destination] = 0.0f;
+            OpenList open;
+            open.push(std::make_pair(0.0f, destination));
+            propagate(terrain, open);
+        }
+    }
+
+    int getDestination() const { return destination; }
+    int nextCell(int cell) const { return next[cell]; }
+    bool isReachable(int cell) const { return integration[cell] < INFINITE_COST; }
+
+    // Repair the field after the cost of one cell changed. Only the cells whose
+    // route ran through or diagonally past the changed cell are reset; they are
+    // then re-solved from the untouched cells bordering them, and any cheaper
+    // routes the change opened up propagate outwards from there.
+    void onCostChanged(const TerrainGrid& terrain, int changed) {
+        if (changed == destination) {
+            *this = FlowField(terrain, destination);
+            return;
+        }
+
+        std::vector<int> invalidated(1, changed);
+        std::vector<char> isInvalid(integration.size(), 0);
+        isInvalid[changed] = 1;
+        forEachAdjacent(terrain, changed, [&](int neighbour) {
+            if (next[neighbour] >= 0 && isAdjacent(terrain, next[neighbour], changed)) {
+                isInvalid[neighbour] = 1;
+                invalidated.push_back(neighbour);
+            }
+        });
+        for (size_t i = 0; i < invalidated.size(); ++i) {
+            int cell = invalidated[i];
+            forEachAdjacent(terrain, cell, [&](int neighbour) {
+                if (!isInvalid[neighbour] && next[neighbour] == cell) {
+                    isInvalid[neighbour] = 1;
+                    invalidated.push_back(neighbour);
+                }
+            });
+        }
+
+        OpenList open;
+        for (int cell : invalidated) {
+            integration[cell] = INFINITE_COST;
+            next[cell] = -1;
+        }
+        for (int cell : invalidated) {
+            forEachNeighbour(terrain, cell, [&](int neighbour, float) {
+                if (!isInvalid[neighbour] && integration[neighbour] < INFINITE_COST) {
+                    open.push(std::make_pair(integration[neighbour], neighbour));
+                }
+            });
+        }
+        propagate(terrain, open);
+    }
+
+private:
+    typedef std::pair<float, int> OpenEntry;
+    typedef std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> OpenList;
+    static constexpr float INFINITE_COST = std::numeric_limits<float>::max();
+
+    // Visit all 8-connected cells regardless of terrain
+    template <typename Visitor>
+    static void forEachAdjacent(const TerrainGrid& terrain, int cell, Visitor visit) {
+        int cols = terrain.getCols();
+        int cx = cell % cols;
+        int cy = cell / cols;
+        for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, terrain.getRows() - 1); ++ny) {
+            for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, cols - 1); ++nx) {
+                if (nx != cx || ny != cy) visit(ny * cols + nx);
+            }
+        }
+    }
+
+    static bool isAdjacent(const TerrainGrid& terrain, int a, int b) {
+        int cols = terrain.getCols();
+        return std::abs(a % cols - b % cols) <= 1 && std::abs(a / cols - b / cols) <= 1;
+    }
+
+    // Visit the 8-connected passable neighbours with the step length to them;
+    // diagonal steps may not cut the corner of an impassable cell
+    template <typename Visitor>
+    static void forEachNeighbour(const TerrainGrid& terrain, int cell, Visitor visit) {
+        static const int offsets[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+        int cols = terrain.getCols();
+        int cx = cell % cols;
+        int cy = cell / cols;
+        for (const auto& offset : offsets) {
+            int nx = cx + offset[0];
+            int ny = cy + offset[1];
+            if (nx < 0 || ny < 0 || nx >= cols || ny >= terrain.getRows()) continue;
+            int neighbour = ny * cols + nx;
+            if (!terrain.isPassable(neighbour)) continue;
+            bool diagonal = offset[0] != 0 && offset[1] != 0;
+            if (diagonal && (!terrain.isPassable(cy * cols + nx) || !terrain.isPassable(ny * cols + cx))) continue;
+            visit(neighbour, diagonal ? 1.41421356f : 1.0f);
+        }
+    }
+
+    // Dijkstra relaxation: a unit in a neighbour cell pays the entered cell's cost
+    void propagate(const TerrainGrid& terrain, OpenList& open) {
+        while (!open.empty()) {
+            OpenEntry entry = open.top();
+            open.pop();
+            int cell = entry.second;
+            if (entry.first > integration[cell]) continue;
+
+            float enterCost = static_cast<float>(terrain.getCost(cell));
+            forEachNeighbour(terrain, cell, [&](int neighbour, float stepLength) {
+                float candidate = integration[cell] + enterCost * stepLength;
+                if (candidate < integration[neighbour]) {
+                    integration[neighbour] = candidate;
+                    next[neighbour] = cell;
+                    open.push(std::make_pair(candidate, neighbour));
+                }
+            });
+        }
+    }
+
+    int destination;
+    std::vector<float> integration;
+    std::vector<int> next;
+};
+
+constexpr float FlowField::INFINITE_COST;
+
+// FlowFieldCache class definition
+// Flow fields keyed by destination cell and reference-counted by the units
+// using them; a field is built on first use and dropped when its last user
+// leaves. Terrain edits are forwarded so live fields repair incrementally.
+class FlowFieldCache {
+public:
+    explicit FlowFieldCache(const TerrainGrid& terrain) : terrain(terrain) {}
+
+    const FlowField& acquire(int destination) {
+        auto it = fields.find(destination);
+        if (it == fields.end()) {
+            it = fields.insert(std::make_pair(destination, Entry(terrain, destination))).first;
+        }
+        ++it->second.users;
+        return it->second.field;
+    }
+
+    void release(int destination) {
+        auto it = fields.find(destination);
+        if (it != fields.end() && --it->second.users <= 0) {
+            fields.erase(it);
+        }
+    }
+
+    const FlowField* find(int destination) const {
+        auto it = fields.find(destination);
+        return it == fields.end() ? nullptr : &it->second.field;
+    }
+
+    void onCostChanged(int cell) {
+        for (auto& entry : fields) {
+            entry.second.field.onCostChanged(terrain, cell);
+        }
+    }
+
+    size_t size() const { return fields.size(); }
+
+private:
+    struct Entry {
+        Entry(const TerrainGrid& terrain, int destination) : field(terrain, destination) {}
+        FlowField field;
+        int users = 0;
+    };
+
+    const TerrainGrid& terrain;
+    std::map<int, Entry> fields;
+};
+
+TerrainGrid terrain(SCREEN_WIDTH, SCREEN_HEIGHT, 20.0f);
+FlowFieldCache flowFields(terrain);
+
+// Launcher class definition
+// Mobile ground launcher. It steers by reading the next cell from the shared
+// flow field of its destination and moves slower over costly terrain.
+class Launcher {
+public:
+    Launcher(float x, float y, float speed) : x(x), y(y), speed(speed) {}
+
+    void moveTo(float destX, float destY) {
+        int cell = terrain.cellAt(destX, destY);
+        if (cell == destination) return;
+        if (destination >= 0) flowFields.release(destination);
+        destination = cell;
+        flowFields.acquire(destination);
+    }
+
+    void update(float deltaTime) {
+        if (destination < 0) return;
+        const FlowField* field = flowFields.find(destination);
+        int cell = terrain.cellAt(x, y);
+        int nextCell = (cell == destination) ? destination : field->nextCell(cell);
+        if (nextCell < 0) return; // Unreachable from here; wait for the terrain to change
+
+        float dx = terrain.cellCenterX(nextCell) - x;
+        float dy = terrain.cellCenterY(nextCell) - y;
+        float distanceSq = dx * dx + dy * dy;
+        float step = speed / terrain.getCost(cell) * deltaTime;
+
+        if (cell == destination && distanceSq <= step * step) {
+            // Arrived: snap to the cell centre and drop the field
+            x += dx;
+            y += dy;
+            flowFields.release(destination);
+            destination = -1;
+        } else if (distanceSq > 0.0001f) {
+            float scale = EngineMath::rsqrt(distanceSq) * step;
+            x += dx * scale;
+            y += dy * scale;
+        }
+    }
+
+    void draw() const {
+        al_draw_filled_rectangle(x - 6, y - 6, x + 6, y + 6, al_map_rgb(0, 160, 255));
+    }
+
+    float getX() const { return x; }
+    float getY() const { return y; }
+    bool isMoving() const { return destination >= 0; }
+
+    SensorFootprint footprint; // Defender-side coverage, maintained in updateEntities
+    int sensorId = -1;         // Entry in sensorNetwork
+
+private:
+    float x, y;
+    float speed;
+    int destination = -1;
+};
+
+// SpatialGrid class definition
+// Uniform bucket grid over the playfield. It is rebuilt once per tick with a
+// counting sort, so every bucket is a contiguous run of one flat index array
+// and a query only touches the cells overlapping its shape.
+class SpatialGrid {
+public:
+    SpatialGrid(float width, float height, float cellSize)
+        : cellSize(cellSize),
+          cols(static_cast<int>(std::ceil(width / cellSize))),
+          rows(static_cast<int>(std::ceil(height / cellSize))),
+          cellStart(cols * rows + 1, 0) {}
+
+    // Re-bucket all entities; indices refer to positions in the given vector
+    template <typename Entity>
+    void rebuild(const std::vector<std::shared_ptr<Entity>>& entities) {
+        const int count = static_cast<int>(entities.size());
+        itemX.resize(count);
+        itemY.resize(count);
+        for (int i = 0; i < count; ++i) {
+            itemX[i] = entities[i]->getX();
+            itemY[i] = entities[i]->getY();
+        }
+        bucket();
+    }
+
+    // Re-bucket raw positions; indices refer to slots in positions
+    void rebuild(const Vec2Batch& positions) {
+        itemX = positions.x;
+        itemY = positions.y;
+        bucket();
+    }
+
+    // Call visit(index) for every entity inside the rectangle (corners in any order)
+    template <typename Visitor>
+    void queryRect(float x0, float y0, float x1, float y1, Visitor visit) const {
+        if (x0 > x1) std::swap(x0, x1);
+        if (y0 > y1) std::swap(y0, y1);
+        int cx0, cy0, cx1, cy1;
+        cellCoords(x0, y0, cx0, cy0);
+        cellCoords(x1, y1, cx1, cy1);
+
+        for (int cy = cy0; cy <= cy1; ++cy) {
+            for (int cx = cx0; cx <= cx1; ++cx) {
+                int cell = cy * cols + cx;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                    int i = items[k];
+                    if (itemX[i] >= x0 && itemX[i] <= x1 && itemY[i] >= y0 && itemY[i] <= y1) {
+                        visit(i);
+                    }
+                }
+            }
+        }
+    }
+
+    // Call visit(index) for every entity within radius of (x, y), in bucket order
+    template <typename Visitor>
+    void queryRadius(float x, float y, float radius, Visitor visit) const {
+        float radiusSq = radius * radius;
+        queryRect(x - radius, y - radius, x + radius, y + radius, [&](int i) {
+            float dx = itemX[i] - x;
+            float dy = itemY[i] - y;
+            if (dx * dx + dy * dy <= radiusSq) {
+                visit(i);
+            }
+        });
+    }
+
+    int size() const { return static_cast<int>(items.size()); }
+    float getX(int index) const { return itemX[index]; } // Position as of the last rebuild
+    float getY(int index) const { return itemY[index]; }
+
+    // Index of the entity closest to (x, y) within maxRadius, or -1 if none
+    int findNearest(float x, float y, float maxRadius) const {
+        int best = -1;
+        float bestDistSq = maxRadius * maxRadius;
+        queryRect(x - maxRadius, y - maxRadius, x + maxRadius, y + maxRadius, [&](int i) {
+            float dx = itemX[i] - x;
+            float dy = itemY[i] - y;
+            float distSq = dx * dx + dy * dy;
+            if (distSq <= bestDistSq) {
+                bestDistSq = distSq;
+                best = i;
+            }
+        });
+        return best;
+    }
+
+private:
+    // Counting sort of itemX/itemY into the buckets
+    void bucket() {
+        const int count = static_cast<int>(itemX.size());
+        itemCell.resize(count);
+        items.resize(count);
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+
+        for (int i = 0; i < count; ++i) {
+            itemCell[i] = cellIndex(itemX[i], itemY[i]);
+            ++cellStart[itemCell[i] + 1];
+        }
+        for (size_t c = 1; c < cellStart.size(); ++c) {
+            cellStart[c] += cellStart[c - 1];
+        }
+        std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < count; ++i) {
+            items[cursor[itemCell[i]]++] = i;
+        }
+    }
+
+    void cellCoords(float x, float y, int& cx, int& cy) const {
+        cx = std::min(std::max(static_cast<int>(x / cellSize), 0), cols - 1);
+        cy = std::min(std::max(static_cast<int>(y / cellSize), 0), rows - 1);
+    }
+
+    int cellIndex(float x, float y) const {
+        int cx, cy;
+        cellCoords(x, y, cx, cy);
+        return cy * cols + cx;
+    }
+
+    float cellSize;
+    int cols, rows;
+    IntArray cellStart; // Bucket c spans items[cellStart[c], cellStart[c + 1])
+    IntArray items;
+    IntArray itemCell;
+    FloatArray itemX, itemY;
+};
+
+// Spatial indexes over enemyTargets / defenseMissiles, rebuilt in updateEntities
+SpatialGrid targetGrid(SCREEN_WIDTH, SCREEN_HEIGHT, 40.0f);
+SpatialGrid missileGrid(SCREEN_WIDTH, SCREEN_HEIGHT, 40.0f);
+SpatialGrid launcherGrid(SCREEN_WIDTH, SCREEN_HEIGHT, 40.0f);
+
+// One entity as seen by a spatial query
+struct Contact {
+    int id;
+    Vec2 position;
+    Vec2 velocity;
+    float distance; // From the query point; 0 for rectangle queries
+};
+
+// WorldSnapshot class definition
+// Immutable copy of the targets and missiles at the end of one tick, with
+// their spatial indexes. Snapshots are shared read-only, so any number of
+// threads can query one while the simulation moves on.
+class WorldSnapshot {
+public:
+    WorldSnapshot()
+        : targets(SCREEN_WIDTH, SCREEN_HEIGHT, 40.0f), missiles(SCREEN_WIDTH, SCREEN_HEIGHT, 40.0f) {}
+
+    long getTick() const { return tick; }
+    int targetCount() const { return static_cast<int>(targetIds.size()); }
+    int missileCount() const { return static_cast<int>(missileIds.size()); }
+
+    // Targets within radius of (x, y), nearest first
+    std::vector<Contact> targetsWithin(float x, float y, float radius) const {
+        std::vector<Contact> found;
+        targets.queryRadius(x, y, radius, [&](int i) { found.push_back(targetContact(i, x, y)); });
+        std::sort(found.begin(), found.end(), closer);
+        return found;
+    }
+
+    // The k targets nearest to (x, y), nearest first. The search radius doubles
+    // until it holds k targets: everything outside is then farther than those.
+    std::vector<Contact> nearestTargets(float x, float y, int k) const {
+        std::vector<Contact> found;
+        if (k <= 0) return found;
+        const float fieldDiagonal = std::sqrt(SCREEN_WIDTH * SCREEN_WIDTH + SCREEN_HEIGHT * SCREEN_HEIGHT);
+        for (float radius = 40.0f;; radius *= 2.0f) {
+            found.clear();
+            targets.queryRadius(x, y, radius, [&](int i) { found.push_back(targetContact(i, x, y)); });
+            if (static_cast<int>(found.size()) >= k) break;
+            if (radius > fieldDiagonal + std::fabs(x) + std::fabs(y)) {
+                // Fewer than k targets in total, or some lie outside the field
+                found.clear();
+                for (int i = 0; i < targetCount(); ++i) found.push_back(targetContact(i, x, y));
+                break;
+            }
+        }
+        size_t keep = std::min(found.size(), static_cast<size_t>(k));
+        std::partial_sort(found.begin(), found.begin() + keep, found.end(), closer);
+        found.resize(keep);
+        return found;
+    }
+
+    // Missiles inside the rectangle (corners in any order), in index order
+    std::vector<Contact> missilesInRect(float x0, float y0, float x1, float y1) const {
+        std::vector<Contact> found;
+        missiles.queryRect(x0, y0, x1, y1, [&](int i) {
+            found.push_back(Contact{missileIds[i], missilePositions.get(i), missileVelocities.get(i), 0.0f});
+        });
+        std::sort(found.begin(), found.end(), [](const Contact& a, const Contact& b) { return a.id < b.id; });
+        return found;
+    }
+
+private:
+    friend class WorldQuery;
+
+    static bool closer(const Contact& a, const Contact& b) {
+        return a.distance < b.distance || (a.distance == b.distance && a.id < b.id);
+    }
+
+    Contact targetContact(int i, float x, float y) const {
+        Vec2 position = targetPositions.get(i);
+        Vec2 offset = position - Vec2(x, y);
+        return Contact{targetIds[i], position, targetVelocities.get(i), std::sqrt(offset.lengthSquared())};
+    }
+
+    long tick = 0;
+    std::vector<int> targetIds, missileIds;
+    Vec2Batch targetPositions, targetVelocities, missilePositions, missileVelocities;
+    SpatialGrid targets, missiles;
+};
+
+// WorldQuery class definition
+// Publishes a WorldSnapshot after every update. Readers take the current one
+// with an atomic load and never touch dataMutex; a snapshot stays valid for
+// as long as a reader holds it. Under dataMutex the update only copies the
+// flat columns (capture); the spatial indexes are built once the lock is
+// released (publish). Retired snapshots nobody holds any more are rebuilt in
+// place, so steady-state publishing does not allocate.
+class WorldQuery {
+public:
+    // Latest published snapshot (empty before the first update)
+    std::shared_ptr<const WorldSnapshot> snapshot() const {
+        // C++14 has no std::atomic<std::shared_ptr>, so the free functions it
+        // deprecates in C++20 are the portable choice here
+        std::shared_ptr<const WorldSnapshot> current = std::atomic_load(&published);
+        return current ? current : std::make_shared<const WorldSnapshot>();
+    }
+
+    // Copy the world as it stands into the next snapshot; caller holds
+    // dataMutex, and the entity lists must already be compacted
+    void capture(long tick) {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        std::shared_ptr<WorldSnapshot> next;
+        for (auto& candidate : retired) {
+            if (candidate.use_count() == 1) {
+                // The last reader's release must be visible before we overwrite its data
+                std::atomic_thread_fence(std::memory_order_acquire);
+                next = candidate;
+                break;
+            }
+        }
+        if (!next) {
+            next = std::make_shared<WorldSnapshot>();
+            if (retired.size() < 4) retired.push_back(next);
+        }
+
+        next->tick = tick;
+        next->targetIds.resize(enemyTargets.size());
+        for (size_t i = 0; i < enemyTargets.size(); ++i) next->targetIds[i] = enemyTargets[i]->getID();
+        next->missileIds.resize(defenseMissiles.size());
+        for (size_t i = 0; i < defenseMissiles.size(); ++i) next->missileIds[i] = defenseMissiles[i]->getID();
+        next->targetPositions = targetStore.position;
+        next->targetVelocities = targetStore.velocity;
+        next->missilePositions = missileStore.position;
+        next->missileVelocities = missileStore.velocity;
+        pending = next;
+    }
+
+    // Index the captured snapshot and make it current; call without dataMutex
+    void publish() {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        if (!pending) return;
+        pending->targets.rebuild(pending->targetPositions);
+        pending->missiles.rebuild(pending->missilePositions);
+        std::atomic_store(&published, std::shared_ptr<const WorldSnapshot>(pending));
+        pending.reset();
+    }
+
+private:
+    std::shared_ptr<const WorldSnapshot> published;
+    std::shared_ptr<WorldSnapshot> pending;              // Captured, not yet indexed
+    std::vector<std::shared_ptr<WorldSnapshot>> retired; // Publisher-only pool, includes the published one
+    std::mutex publishMutex; // Orders capture and publish; taken inside dataMutex, never around it
+};
+
+WorldQuery worldQuery;
+
+// Stand-off noise jammer patrolling north-south
+struct Jammer {
+    float x, y;
+    float speedY;
+    float power;            // Jamming strength; 4e6 halves a sensor's range at 500 units in the main lobe
+    float settledX, settledY; // Position the range tables were last built against
+};
+
+// JammerField class definition
+// All active jammers. The version advances only when a jammer has moved
+// more than MOVE_THRESHOLD since the tables were built, so per-sensor range
+// tables stay valid across the many small per-tick movements.
+class JammerField {
+public:
+    static constexpr float MOVE_THRESHOLD = 10.0f;
+
+    void add(float x, float y, float speedY, float power) {
+        jammers.push_back(Jammer{x, y, speedY, power, x, y});
+        ++version;
+    }
+
+    void clear() {
+        jammers.clear();
+        ++version;
+    }
+
+    void update(float deltaTime) {
+        bool moved = false;
+        for (auto& jammer : jammers) {
+            jammer.y += jammer.speedY * deltaTime;
+            if (jammer.y < 50.0f) jammer.speedY = std::fabs(jammer.speedY);
+            if (jammer.y > SCREEN_HEIGHT - 50.0f) jammer.speedY = -std::fabs(jammer.speedY);
+            float dx = jammer.x - jammer.settledX;
+            float dy = jammer.y - jammer.settledY;
+            if (dx * dx + dy * dy > MOVE_THRESHOLD * MOVE_THRESHOLD) moved = true;
+        }
+        if (moved) {
+            for (auto& jammer : jammers) {
+                jammer.settledX = jammer.x;
+                jammer.settledY = jammer.y;
+            }
+            ++version;
+        }
+    }
+
+    // Jamming-to-noise ratio seen by a sensor at (x, y) looking along unit direction (dirX, dirY)
+    float noiseAt(float x, float y, float dirX, float dirY) const {
+        float total = 0.0f;
+        for (const auto& jammer : jammers) {
+            float dx = jammer.settledX - x;
+            float dy = jammer.settledY - y;
+            float distSq = std::max(dx * dx + dy * dy, 100.0f);
+            float cosine = (dx * dirX + dy * dirY) * EngineMath::rsqrt(distSq);
+            // Narrow main lobe on top of a flat sidelobe floor
+            float lobe = cosine > 0.0f ? std::pow(cosine, 16.0f) : 0.0f;
+            total += jammer.power * (SIDELOBE_GAIN + (1.0f - SIDELOBE_GAIN) * lobe) / distSq;
+        }
+        return total;
+    }
+
+    // Detection range left once noise is added: echo power falls with range^4
+    static float jammedRange(float range, float noise) {
+        return noise > 0.0f ? range / std::sqrt(std::sqrt(1.0f + noise)) : range;
+    }
+
+    long getVersion() const { return version; }
+    const std::vector<Jammer>& getJammers() const { return jammers; }
+
+private:
+    static constexpr float SIDELOBE_GAIN = 0.02f;
+
+    std::vector<Jammer> jammers;
+    long version = 0;
+};
+
+JammerField jammerField;
+
+// JamTable class definition
+// Detection range of one sensor per azimuth sector under the current jamming.
+// Rebuilt only when the jammer field version changes or the sensor moves
+// more than the jammer threshold; lookups are one atan2 and an index.
+class JamTable {
+public:
+    static const int SECTORS = 64;
+
+    void refresh(float x, float y, float range, const JammerField& field) {
+        float dx = x - builtX;
+        float dy = y - builtY;
+        if (builtVersion == field.getVersion() && range == builtRange &&
+            dx * dx + dy * dy <= JammerField::MOVE_THRESHOLD * JammerField::MOVE_THRESHOLD) {
+            return;
+        }
+        builtX = x;
+        builtY = y;
+        builtRange = range;
+        builtVersion = field.getVersion();
+        ++revision;
+        float angle[SECTORS], sine[SECTORS], cosine[SECTORS];
+        for (int sector = 0; sector < SECTORS; ++sector) {
+            angle[sector] = (sector + 0.5f) * (2.0f * MATH_PI / SECTORS) - MATH_PI;
+        }
+        EngineMath::sinCosBatch(angle, sine, cosine, SECTORS);
+        for (int sector = 0; sector < SECTORS; ++sector) {
+            sectorRange[sector] = JammerField::jammedRange(range, field.noiseAt(x, y, cosine[sector], sine[sector]));
+        }
+        minRange = *std::min_element(sectorRange, sectorRange + SECTORS);
+    }
+
+    // Detection range towards offset (dx, dy) from the sensor
+    float rangeToward(float dx, float dy) const {
+        return sectorRange[sectorOf(dx, dy)];
+    }
+
+    bool covers(float dx, float dy) const {
+        float distSq = dx * dx + dy * dy;
+        if (distSq <= minRange * minRange) return true; // Inside every sector, skip the bearing
+        float range = rangeToward(dx, dy);
+        return distSq <= range * range;
+    }
+
+    float sectorRangeAt(int sector) const { return sectorRange[sector]; }
+    long getRevision() const { return revision; } // Changes whenever the sector ranges are rebuilt
+
+    static int sectorOf(float dx, float dy) {
+        int sector = static_cast<int>((EngineMath::atan2(dy, dx) + MATH_PI) * (SECTORS / (2.0f * MATH_PI)));
+        return std::min(std::max(sector, 0), SECTORS - 1);
+    }
+
+private:
+    float builtX = 0.0f, builtY = 0.0f, builtRange = -1.0f;
+    long builtVersion = -1;
+    long revision = 0;
+    float sectorRange[SECTORS] = {};
+    float minRange = 0.0f;
+};
+
+// One detection sensor; it scans on every scanEvery-th detection pass
+struct Sensor {
+    float x, y;
+    float range;
+    int scanEvery;
+};
+
+// SensorNetwork class definition
+// Scans all due sensors against the target grid in parallel. Each sensor
+// fills its own detection list (in grid bucket order, so independent of
+// thread scheduling); the lists are then merged in sensor order into one
+// ascending list of detected targets.
+class SensorNetwork {
+public:
+    int addSensor(float x, float y, float range, int scanEvery) {
+        sensors.push_back(Sensor{x, y, range, std::max(scanEvery, 1)});
+        detections.emplace_back();
+        jamTables.emplace_back();
+        return static_cast<int>(sensors.size()) - 1;
+    }
+
+    void moveSensor(int id, float x, float y) {
+        sensors[id].x = x;
+        sensors[id].y = y;
+    }
+
+    void clear() {
+        sensors.clear();
+        detections.clear();
+        jamTables.clear();
+        due.clear();
+        detected.clear();
+    }
+
+    // Run detection pass number pass against the targets indexed in grid,
+    // with each sensor's reach cut down by the jamming
+    void scan(long pass, const SpatialGrid& grid, const JammerField& jamming, WorkerPool& pool) {
+        due.clear();
+        for (size_t i = 0; i < sensors.size(); ++i) {
+            // Stagger sensors with the same period across passes
+            if ((pass + static_cast<long>(i)) % sensors[i].scanEvery == 0) {
+                due.push_back(static_cast<int>(i));
+            } else {
+                detections[i].clear();
+            }
+        }
+
+        pool.parallelFor(static_cast<int>(due.size()), 8, [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                const Sensor& sensor = sensors[due[k]];
+                std::vector<int>& found = detections[due[k]];
+                JamTable& jamTable = jamTables[due[k]];
+                jamTable.refresh(sensor.x, sensor.y, sensor.range, jamming);
+                found.clear();
+                grid.queryRadius(sensor.x, sensor.y, sensor.range, [&](int target) {
+                    if (jamTable.covers(grid.getX(target) - sensor.x, grid.getY(target) - sensor.y)) {
+                        found.push_back(target);
+                    }
+                });
+            }
+        });
+
+        // Deterministic merge: flag hits in sensor order, then read the flags back in target order
+        seen.assign(grid.size(), 0);
+        for (int sensor : due) {
+            for (int target : detections[sensor]) seen[target] = 1;
+        }
+        detected.clear();
+        for (int target = 0; target < grid.size(); ++target) {
+            if (seen[target]) detected.push_back(target);
+        }
+    }
+
+    size_t size() const { return sensors.size(); }
+    const std::vector<int>& getDetections(int sensor) const { return detections[sensor]; }
+    const std::vector<int>& getDetected() const { return detected; } // Target indices, ascending
+
+private:
+    std::vector<Sensor> sensors;
+    std::vector<std::vector<int>> detections; // Per sensor, from its latest scan
+    std::vector<JamTable> jamTables;          // Per sensor
+    std::vector<int> due;
+    std::vector<unsigned char> seen;
+    std::vector<int> detected;
+};
+
+SensorNetwork sensorNetwork;
+
+// PhasedArrayRadar class definition
+// Radar with a finite beam-time budget per scan frame. Search dwells sweep
+// one azimuth sector each and open tracks on whatever they find; track
+// dwells re-illuminate one existing track. Every frame the pending tasks
+// are ranked by priority per second of dwell and packed greedily into the
+// budget (the greedy knapsack bound), so under heavy raids the radar, not
+// the launchers, decides which targets can be engaged.
+class PhasedArrayRadar {
+public:
+    static const int SECTORS = 36;              // 5 degree beams over the western half-plane
+    static constexpr float FRAME_BUDGET = 0.25f; // Seconds of beam time per scan frame
+    static constexpr float SEARCH_DWELL = 0.004f;
+    static constexpr float TRACK_DWELL = 0.002f;
+    static const int TRACK_TIMEOUT = 3; // Frames without an update before a track is dropped
+
+    PhasedArrayRadar(float x, float y, float range) : x(x), y(y), range(range), sectorAge(SECTORS, 0) {
+        jamTable.refresh(x, y, range, JammerField());
+    }
+
+    // Plan and execute one scan frame against the targets indexed in grid
+    // (indices into enemyTargets). Fills the list of targets confirmed this frame.
+    void scanFrame(const SpatialGrid& grid, const std::vector<std::shared_ptr<EnemyTarget>>& targets,
+                   const JammerField& jamming) {
+        ++frame;
+        jamTable.refresh(x, y, range, jamming);
+        binTargets(grid, targets);
+
+        // Drop tracks whose target is gone or has gone stale
+        tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [this](const Track& track) {
+            auto target = track.target.lock();
+            return !target || !target->isActiveTarget() || frame - track.lastUpdate > TRACK_TIMEOUT;
+        }), tracks.end());
+        trackIndex.clear();
+        for (size_t i = 0; i < tracks.size(); ++i) trackIndex[tracks[i].targetID] = static_cast<int>(i);
+
+        // Candidate dwells: every search sector, every track
+        tasks.clear();
+        for (int sector = 0; sector < SECTORS; ++sector) {
+            // Unvisited sectors gain priority each frame so search never starves completely
+            tasks.push_back(Task{SEARCH, sector, SEARCH_DWELL, 1.0f + 0.5f * sectorAge[sector]});
+        }
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            auto target = tracks[i].target.lock();
+            float threat = target->getX() / SCREEN_WIDTH; // Closer to the defended edge is more urgent
+            float staleness = static_cast<float>(frame - tracks[i].lastUpdate);
+            tasks.push_back(Task{TRACK, static_cast<int>(i), TRACK_DWELL, 2.0f + 4.0f * threat + staleness});
+        }
+
+        // Greedy knapsack: best priority per second of dwell first, skip what no longer fits
+        std::sort(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) {
+            return a.priority * b.dwell > b.priority * a.dwell;
+        });
+        demand = 0.0f;
+        used = 0.0f;
+        dropped = 0;
+        confirmed.clear();
+        for (const Task& task : tasks) {
+            demand += task.dwell;
+            if (used + task.dwell > FRAME_BUDGET) {
+                ++dropped;
+                continue;
+            }
+            used += task.dwell;
+            if (task.type == SEARCH) {
+                search(task.index, targets);
+            } else {
+                illuminate(tracks[task.index], targets);
+            }
+        }
+        for (int sector = 0; sector < SECTORS; ++sector) ++sectorAge[sector];
+        for (int sector : searched) sectorAge[sector] = 0;
+        searched.clear();
+
+        std::sort(confirmed.begin(), confirmed.end());
+        confirmed.erase(std::unique(confirmed.begin(), confirmed.end()), confirmed.end());
+    }
+
+    const std::vector<int>& getConfirmed() const { return confirmed; } // Target indices, ascending
+    size_t trackCount() const { return tracks.size(); }
+    float getLoad() const { return demand / FRAME_BUDGET; } // Above 1 means saturated
+    float getUtilization() const { return used / FRAME_BUDGET; }
+    int getDropped() const { return dropped; }
+    float getX() const { return x; }
+    float getY() const { return y; }
+    const JamTable& getJamTable() const { return jamTable; }
+
+private:
+    enum TaskType { SEARCH, TRACK };
+
+    struct Task {
+        TaskType type;
+        int index; // Sector or track
+        float dwell;
+        float priority;
+    };
+
+    struct Track {
+        std::weak_ptr<EnemyTarget> target;
+        int targetID;
+        long lastUpdate;
+    };
+
+    // Bucket every target in range by beam sector (counting sort)
+    void binTargets(const SpatialGrid& grid, const std::vector<std::shared_ptr<EnemyTarget>>& targets) {
+        inRange.clear();
+        offsetX.clear();
+        offsetY.clear();
+        grid.queryRadius(x, y, range, [&](int i) {
+            if (!jamTable.covers(targets[i]->getX() - x, targets[i]->getY() - y)) return;
+            inRange.push_back(i);
+            offsetX.push_back(x - targets[i]->getX()); // Boresight points west along -x
+            offsetY.push_back(targets[i]->getY() - y);
+        });
+        int count = static_cast<int>(inRange.size());
+        bearing.resize(count);
+        EngineMath::atan2Batch(offsetY.data(), offsetX.data(), bearing.data(), count);
+        inRangeSector.resize(count);
+        for (int k = 0; k < count; ++k) {
+            int sector = static_cast<int>((bearing[k] + MATH_HALF_PI) / MATH_PI * SECTORS);
+            inRangeSector[k] = std::min(std::max(sector, 0), SECTORS - 1);
+        }
+        sectorStart.assign(SECTORS + 1, 0);
+        for (int sector : inRangeSector) ++sectorStart[sector + 1];
+        for (int sector = 0; sector < SECTORS; ++sector) sectorStart[sector + 1] += sectorStart[sector];
+        sectorItems.resize(inRange.size());
+        std::vector<int> cursor(sectorStart.begin(), sectorStart.end() - 1);
+        for (size_t k = 0; k < inRange.size(); ++k) sectorItems[cursor[inRangeSector[k]]++] = inRange[k];
+    }
+
+    void search(int sector, const std::vector<std::shared_ptr<EnemyTarget>>& targets) {
+        searched.push_back(sector);
+        for (int k = sectorStart[sector]; k < sectorStart[sector + 1]; ++k) {
+            const auto& target = targets[sectorItems[k]];
+            auto existing = trackIndex.find(target->getID());
+            if (existing == trackIndex.end()) {
+                trackIndex.emplace(target->getID(), static_cast<int>(tracks.size()));
+                tracks.push_back(Track{target, target->getID(), frame});
+            } else {
+                tracks[existing->second].lastUpdate = frame;
+            }
+            confirmed.push_back(sectorItems[k]);
+        }
+    }
+
+    void illuminate(Track& track, const std::vector<std::shared_ptr<EnemyTarget>>& targets) {
+        auto target = track.target.lock();
+        if (!jamTable.covers(target->getX() - x, target->getY() - y)) return; // Out of coverage; the track will time out
+        track.lastUpdate = frame;
+        int index = target->getSlot();
+        if (index >= 0 && index < static_cast<int>(targets.size())) confirmed.push_back(index);
+    }
+
+    float x, y, range;
+    JamTable jamTable;
+    long frame = 0;
+    std::vector<Track> tracks;
+    std::unordered_map<int, int> trackIndex; // Target ID to position in tracks
+    std::vector<Task> tasks;
+    std::vector<int> sectorAge; // Frames since each sector was last searched
+    std::vector<int> searched;
+    std::vector<int> inRange, inRangeSector, sectorStart, sectorItems;
+    FloatArray offsetX, offsetY, bearing; // Per in-range target, for the batch atan2
+    std::vector<int> confirmed;
+    float demand = 0.0f, used = 0.0f;
+    int dropped = 0;
+};
+
+PhasedArrayRadar radar(SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f, RADAR_RANGE);
+
+// Keep the defense's radar coverage in step with the jamming: the radar's
+// sector ranges, re-stamped whenever its jam table is rebuilt
+void stampRadarCoverage() {
+    // Assume dataMutex is locked by the caller
+    const JamTable& table = radar.getJamTable();
+    visibility[SIDE_DEFENSE].updateShapedSensor(radarFootprint, radar.getX(), radar.getY(), RADAR_RANGE,
+                                                table.getRevision(),
+                                                [&](float dx, float dy) { return table.covers(dx, dy); });
+}
+
+// WorldDigest class definition
+// Hash of the simulation state after one tick: every entity's ID, active
+// flag and position quantized to 1/16 unit (missiles also their target's
+// ID). Entities are hashed in parallel in fixed-size chunks and the chunk
+// hashes folded in order, so the digest is independent of the thread count.
+// Per-entity hashes are kept so a mismatch can be traced to one entity.
+class WorldDigest {
+public:
+    static const int CHUNK = 256;
+    static constexpr float QUANTUM = 16.0f; // Steps per unit
+
+    // Per-entity record: ID with the top bit set for missiles, and its hash
+    struct Entry {
+        uint32_t id;
+        uint32_t hash;
+    };
+
+    // Assume dataMutex is locked by the caller
+    uint64_t compute(WorkerPool& pool) {
+        const int targetCount = static_cast<int>(enemyTargets.size());
+        const int total = targetCount + static_cast<int>(defenseMissiles.size());
+        entries.resize(total);
+        chunkHashes.resize((total + CHUNK - 1) / CHUNK);
+
+        pool.parallelFor(static_cast<int>(chunkHashes.size()), 1, [&](int begin, int end) {
+            for (int chunk = begin; chunk < end; ++chunk) {
+                uint64_t hash = 0;
+                for (int i = chunk * CHUNK; i < std::min((chunk + 1) * CHUNK, total); ++i) {
+                    entries[i] = i < targetCount ? hashTarget(i) : hashMissile(i - targetCount);
+                    hash = mix(hash ^ (static_cast<uint64_t>(entries[i].id) << 32 | entries[i].hash));
+                }
+                chunkHashes[chunk] = hash;
+            }
+        });
+
+        uint64_t digest = mix(static_cast<uint64_t>(targetCount) << 32 | static_cast<uint64_t>(total - targetCount));
+        for (uint64_t chunkHash : chunkHashes) digest = mix(digest ^ chunkHash);
+        return digest;
+    }
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+    static int32_t quantize(float value) { return static_cast<int32_t>(std::lrint(value * QUANTUM)); }
+
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+private:
+    static uint32_t hashFields(uint32_t id, int32_t x, int32_t y, uint32_t extra) {
+        uint64_t h = mix(static_cast<uint64_t>(id) << 32 | extra);
+        h = mix(h ^ (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y)));
+        return static_cast<uint32_t>(h ^ (h >> 32));
+    }
+
+    Entry hashTarget(int i) const {
+        uint32_t id = static_cast<uint32_t>(enemyTargets[i]->getID());
+        return Entry{id, hashFields(id, quantize(targetStore.position.x[i]), quantize(targetStore.position.y[i]),
+                                    targetStore.active[i])};
+    }
+
+    Entry hashMissile(int i) const {
+        uint32_t id = static_cast<uint32_t>(defenseMissiles[i]->getID()) | 0x80000000u;
+        auto target = defenseMissiles[i]->target.lock();
+        uint32_t targetID = target ? static_cast<uint32_t>(target->getID()) : 0xFFFFu;
+        return Entry{id, hashFields(id, quantize(missileStore.position.x[i]), quantize(missileStore.position.y[i]),
+                                    missileStore.active[i] | targetID << 1)};
+    }
+
+    std::vector<Entry> entries;
+    std::vector<uint64_t> chunkHashes;
+};
+
+// Current unit selection and the in-progress drag box (main thread only)
+struct Selection {
+    std::vector<std::weak_ptr<EnemyTarget>> targets;
+    std::vector<std::weak_ptr<DefenseMissile>> missiles;
+    std::vector<std::weak_ptr<Launcher>> launchers;
+    bool dragging = false;
+    float dragStartX = 0.0f, dragStartY = 0.0f;
+    float dragEndX = 0.0f, dragEndY = 0.0f;
+};
+
+Selection selection;
+const float PICK_RADIUS = 15.0f; // Click tolerance around an entity
+
+#ifndef HEADLESS
+// ParticlePool class definition
+// Fixed-capacity visual effects pool in structure-of-arrays layout. Motion is
+// integrated four particles at a time, dead particles are swap-removed, and
+// the whole pool is drawn with a single al_draw_prim call.
+class ParticlePool {
+public:
+    static const int CAPACITY = 16384;
+
+    ParticlePool()
+        : x(CAPACITY), y(CAPACITY), vx(CAPACITY), vy(CAPACITY),
+          age(CAPACITY), life(CAPACITY), radius(CAPACITY),
+          r(CAPACITY), g(CAPACITY), b(CAPACITY) {
+        vertices.reserve(CAPACITY * 6);
+    }
+
+    // Fireball and debris where a missile meets its target
+    void explosion(float atX, float atY) {
+        for (int i = 0; i < 24; ++i) {
+            float speed = 20.0f + randomUnit() * 80.0f;
+            float sine, cosine;
+            EngineMath::sinCos(randomUnit() * 6.2831853f, sine, cosine);
+            emit(atX, atY, cosine * speed, sine * speed,
+                 0.4f + randomUnit() * 0.4f, 3.0f, 1.0f, 0.4f + randomUnit() * 0.4f, 0.0f);
+        }
+        for (int i = 0; i < 8; ++i) {
+            float speed = 80.0f + randomUnit() * 120.0f;
+            float sine, cosine;
+            EngineMath::sinCos(randomUnit() * 6.2831853f, sine, cosine);
+            emit(atX, atY, cosine * speed, sine * speed,
+                 0.8f + randomUnit() * 0.6f, 1.5f, 0.6f, 0.6f, 0.6f);
+        }
+    }
+
+    // Flash where a target reaches the defended edge
+    void impact(float atX, float atY) {
+        for (int i = 0; i < 12; ++i) {
+            float speed = 10.0f + randomUnit() * 40.0f;
+            float sine, cosine;
+            EngineMath::sinCos(randomUnit() * 6.2831853f, sine, cosine);
+            emit(atX, atY, cosine * speed, sine * speed,
+                 0.3f + randomUnit() * 0.3f, 2.5f, 1.0f, 0.2f, 0.2f);
+        }
+    }
+
+    // One puff of exhaust behind a missile
+    void smoke(float atX, float atY) {
+        emit(atX, atY, (randomUnit() - 0.5f) * 10.0f, (randomUnit() - 0.5f) * 10.0f,
+             0.6f, 1.5f, 0.5f, 0.5f, 0.5f);
+    }
+
+    void update(float deltaTime) {
+        const float drag = 1.0f - 1.5f * deltaTime;
+        int i = 0;
+#ifdef __SSE2__
+        const __m128 dt = _mm_set1_ps(deltaTime);
+        const __m128 damping = _mm_set1_ps(drag);
+        for (; i + 4 <= count; i += 4) {
+            __m128 px = _mm_loadu_ps(&x[i]);
+            __m128 py = _mm_loadu_ps(&y[i]);
+            __m128 pvx = _mm_loadu_ps(&vx[i]);
+            __m128 pvy = _mm_loadu_ps(&vy[i]);
+            _mm_storeu_ps(&x[i], _mm_add_ps(px, _mm_mul_ps(pvx, dt)));
+            _mm_storeu_ps(&y[i], _mm_add_ps(py, _mm_mul_ps(pvy, dt)));
+            _mm_storeu_ps(&vx[i], _mm_mul_ps(pvx, damping));
+            _mm_storeu_ps(&vy[i], _mm_mul_ps(pvy, damping));
+            _mm_storeu_ps(&age[i], _mm_add_ps(_mm_loadu_ps(&age[i]), dt));
+        }
+#endif
+        for (; i < count; ++i) {
+            x[i] += vx[i] * deltaTime;
+            y[i] += vy[i] * deltaTime;
+            vx[i] *= drag;
+            vy[i] *= drag;
+            age[i] += deltaTime;
+        }
+
+        // Swap-remove expired particles
+        for (int p = 0; p < count;) {
+            if (age[p] >= life[p]) {
+                moveParticle(count - 1, p);
+                --count;
+            } else {
+                ++p;
+            }
+        }
+    }
+
+    void draw() const {
+        vertices.clear();
+        for (int i = 0; i < count; ++i) {
+            float fade = 1.0f - age[i] / life[i];
+            ALLEGRO_COLOR color = al_map_rgba_f(r[i] * fade, g[i] * fade, b[i] * fade, fade); // Premultiplied alpha
+            float x0 = x[i] - radius[i], x1 = x[i] + radius[i];
+            float y0 = y[i] - radius[i], y1 = y[i] + radius[i];
+            addVertex(x0, y0, color);
+            addVertex(x1, y0, color);
+            addVertex(x1, y1, color);
+            addVertex(x0, y0, color);
+            addVertex(x1, y1, color);
+            addVertex(x0, y1, color);
+        }
+        if (!vertices.empty()) {
+            al_draw_prim(vertices.data(), nullptr, nullptr, 0, static_cast<int>(vertices.size()), ALLEGRO_PRIM_TRIANGLE_LIST);
+        }
+    }
+
+    int size() const { return count; }
+
+private:
+    // New particles are dropped once the pool is full
+    void emit(float px, float py, float pvx, float pvy, float lifetime, float particleRadius,
+              float red, float green, float blue) {
+        if (count == CAPACITY) return;
+        int i = count++;
+        x[i] = px; y[i] = py;
+        vx[i] = pvx; vy[i] = pvy;
+        age[i] = 0.0f; life[i] = lifetime;
+        radius[i] = particleRadius;
+        r[i] = red; g[i] = green; b[i] = blue;
+    }
+
+    void moveParticle(int from, int to) {
+        x[to] = x[from]; y[to] = y[from];
+        vx[to] = vx[from]; vy[to] = vy[from];
+        age[to] = age[from]; life[to] = life[from];
+        radius[to] = radius[from];
+        r[to] = r[from]; g[to] = g[from]; b[to] = b[from];
+    }
+
+    void addVertex(float vxPos, float vyPos, ALLEGRO_COLOR color) const {
+        ALLEGRO_VERTEX vertex;
+        vertex.x = vxPos;
+        vertex.y = vyPos;
+        vertex.z = 0.0f;
+        vertex.u = vertex.v = 0.0f;
+        vertex.color = color;
+        vertices.push_back(vertex);
+    }
+
+    float randomUnit() { return static_cast<float>(random() & 0xFFFF) / 65536.0f; }
+
+    int count = 0;
+    std::vector<float> x, y, vx, vy, age, life, radius, r, g, b;
+    mutable std::vector<ALLEGRO_VERTEX> vertices; // Reused draw batch
+    std::minstd_rand random;
+};
+#else
+// Headless builds compile the effects out; calls reduce to nothing
+class ParticlePool {
+public:
+    void explosion(float, float) {}
+    void impact(float, float) {}
+    void smoke(float, float) {}
+    void update(float) {}
+    void draw() const {}
+    int size() const { return 0; }
+};
+#endif
+
+ParticlePool particles;
+
+// TrailBuffer class definition
+// Flight history for a fixed number of entities. Every entity that gets a
+// slot owns HISTORY consecutive entries of one contiguous ring buffer per
+// coordinate, so memory is fixed at construction and no entity allocates.
+class TrailBuffer {
+public:
+    TrailBuffer(int slots, int history, int sampleInterval)
+        : slots(slots), history(history), sampleInterval(sampleInterval),
+          x(slots * history), y(slots * history),
+          head(slots, 0), length(slots, 0) {
+        freeSlots.reserve(slots);
+        for (int slot = slots - 1; slot >= 0; --slot) {
+            freeSlots.push_back(slot);
+        }
+        vertices.reserve(slots * (history - 1) * 2);
+    }
+
+    // A slot for a new entity, or -1 once every slot is taken
+    int acquire() {
+        if (freeSlots.empty()) return -1;
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        head[slot] = 0;
+        length[slot] = 0;
+        return slot;
+    }
+
+    void release(int slot) {
+        if (slot < 0) return;
+        length[slot] = 0; // Stop drawing the trail now, not when the slot is reused
+        freeSlots.push_back(slot);
+    }
+
+    // True on the ticks where positions should be recorded
+    bool isSampleTick(long tick) const { return tick % sampleInterval == 0; }
+    void setSampleInterval(int ticks) { sampleInterval = std::max(ticks, 1); }
+
+    void record(int slot, float px, float py) {
+        int base = slot * history;
+        x[base + head[slot]] = px;
+        y[base + head[slot]] = py;
+        head[slot] = (head[slot] + 1) % history;
+        length[slot] = std::min(length[slot] + 1, history);
+    }
+
+    // All live trails as one line list, fading towards the oldest sample
+    void draw(unsigned char red, unsigned char green, unsigned char blue) const {
+        vertices.clear();
+        for (int slot = 0; slot < slots; ++slot) {
+            int count = length[slot];
+            if (count < 2) continue;
+            int base = slot * history;
+            int oldest = (head[slot] - count + history) % history;
+            for (int k = 1; k < count; ++k) {
+                int from = base + (oldest + k - 1) % history;
+                int to = base + (oldest + k) % history;
+                unsigned char alpha = static_cast<unsigned char>(255 * k / count);
+                ALLEGRO_COLOR color = al_map_rgba(red * alpha / 255, green * alpha / 255, blue * alpha / 255, alpha);
+                addVertex(x[from], y[from], color);
+                addVertex(x[to], y[to], color);
+            }
+        }
+        if (!vertices.empty()) {
+            al_draw_prim(vertices.data(), nullptr, nullptr, 0, static_cast<int>(vertices.size()), ALLEGRO_PRIM_LINE_LIST);
+        }
+    }
+
+    size_t memoryBytes() const {
+        return (x.size() + y.size()) * sizeof(float) + (head.size() + length.size() + slots) * sizeof(int) +
+               vertices.capacity() * sizeof(ALLEGRO_VERTEX);
+    }
+
+private:
+    void addVertex(float px, float py, ALLEGRO_COLOR color) const {
+        ALLEGRO_VERTEX vertex;
+        vertex.x = px;
+        vertex.y = py;
+        vertex.z = 0.0f;
+        vertex.u = vertex.v = 0.0f;
+        vertex.color = color;
+        vertices.push_back(vertex);
+    }
+
+    int slots, history;
+    int sampleInterval; // Ticks between samples
+    std::vector<float> x, y;
+    std::vector<int> head;   // Next write position per slot
+    std::vector<int> length; // Valid samples per slot
+    std::vector<int> freeSlots;
+    mutable std::vector<ALLEGRO_VERTEX> vertices; // Reused draw batch
+};
+
+TrailBuffer targetTrails(2048, 64, 6);
+TrailBuffer missileTrails(2048, 64, 3);
+bool showTrails = true;
+
+// Kills and leaks since the raid planner last looked, filled in by updateEntities
+struct BattleReport {
+    std::vector<float> killX, killY;
+    int leaks = 0;
+};
+
+BattleReport battleReport;
+
+// Close a statistics phase: fold the per-thread counts and pass them on to
+// the metrics and the raid planner's report
+void endStatsPhase() {
+    const StatValues& phase = engineStats.endPhase();
+    killsTotal.add(phase[STAT_KILLS]);
+    leaksTotal.add(phase[STAT_LEAKS]);
+    launchesTotal.add(phase[STAT_LAUNCHES]);
+    battleReport.leaks += static_cast<int>(phase[STAT_LEAKS]);
+}
+
+// One engagement event in a telemetry file. Records are fixed-size and
+// native-endian so files can be streamed back in large blocks.
+struct TelemetryEvent {
+    enum Type : uint32_t { INTERCEPT, LEAK, MISS, TYPE_COUNT };
+    uint32_t tick;
+    uint32_t type;
+    float x, y; // Kill point, edge crossing, or where a missile gave up
+};
+
+typedef std::vector<TelemetryEvent, AlignedAllocator<TelemetryEvent>> TelemetryBlock;
+
+// TelemetryRecorder class definition
+// Appends engagement events to a file (--telemetry-out) in blocks. Called by
+// updateEntities with dataMutex held; does nothing until opened.
+class TelemetryRecorder {
+public:
+    static const size_t BLOCK = HUGE_PAGE_SIZE / sizeof(TelemetryEvent); // One 2 MB page under --huge-pages
+
+    ~TelemetryRecorder() { flush(); }
+
+    bool open(const char* path) {
+        file.open(path, std::ios::binary);
+        return static_cast<bool>(file);
+    }
+
+    bool isOpen() const { return file.is_open(); }
+
+    void record(long tick, TelemetryEvent::Type type, float x, float y) {
+        if (!file.is_open()) return;
+        if (pending.capacity() < BLOCK) pending.reserve(BLOCK); // On first use, once --huge-pages has been read
+        pending.push_back(TelemetryEvent{static_cast<uint32_t>(tick), type, x, y});
+        if (pending.size() == BLOCK) flush();
+    }
+
+    void flush() {
+        if (pending.empty()) return;
+        file.write(reinterpret_cast<const char*>(pending.data()), pending.size() * sizeof(TelemetryEvent));
+        file.flush();
+        pending.clear();
+    }
+
+private:
+    std::ofstream file;
+    TelemetryBlock pending;
+};
+
+TelemetryRecorder telemetry;
+
+// HeatMap class definition
+// Event counts per CELL-sized cell of the battlefield, one layer per
+// event type. Positions outside the field land in the nearest edge cell.
+class HeatMap {
+public:
+    static const int CELL = 10;
+
+    HeatMap()
+        : cols(static_cast<int>(SCREEN_WIDTH) / CELL),
+          rows(static_cast<int>(SCREEN_HEIGHT) / CELL),
+          counts(TelemetryEvent::TYPE_COUNT * cols * rows, 0) {}
+
+    // Events of unknown type are counted as malformed and otherwise skipped
+    void add(const TelemetryEvent* events, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const TelemetryEvent& event = events[i];
+            if (event.type >= TelemetryEvent::TYPE_COUNT || !(event.x == event.x) || !(event.y == event.y)) {
+                ++malformed;
+                continue;
+            }
+            int column = static_cast<int>(std::min(std::max(event.x / CELL, 0.0f), cols - 1.0f));
+            int row = static_cast<int>(std::min(std::max(event.y / CELL, 0.0f), rows - 1.0f));
+            ++counts[(event.type * rows + row) * cols + column];
+        }
+    }
+
+    void merge(const HeatMap& other) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+        malformed += other.malformed;
+    }
+
+    uint64_t at(int type, int column, int row) const { return counts[(type * rows + row) * cols + column]; }
+    uint64_t total(int type) const {
+        uint64_t sum = 0;
+        for (int i = 0; i < cols * rows; ++i) sum += counts[type * cols * rows + i];
+        return sum;
+    }
+    uint64_t getMalformed() const { return malformed; }
+    bool operator==(const HeatMap& other) const { return counts == other.counts && malformed == other.malformed; }
+
+    // One layer as a grayscale PGM, log-scaled so sparse cells stay visible
+    bool writePgm(int type, const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) return false;
+        uint64_t peak = 0;
+        for (int i = 0; i < cols * rows; ++i) peak = std::max(peak, counts[type * cols * rows + i]);
+        file << "P5\n" << cols << " " << rows << "\n255\n";
+        for (int i = 0; i < cols * rows; ++i) {
+            uint64_t count = counts[type * cols * rows + i];
+            double level = peak > 0 ? std::log1p(static_cast<double>(count)) / std::log1p(static_cast<double>(peak)) : 0.0;
+            file.put(static_cast<char>(static_cast<unsigned char>(level * 255.0 + 0.5)));
+        }
+        return static_cast<bool>(file);
+    }
+
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+
+private:
+    int cols, rows;
+    std::vector<uint64_t> counts;
+    uint64_t malformed = 0;
+};
+
+// Bin a block of events into per-slice partial maps on the pool. Each slice
+// owns its partial map, so there is no sharing while binning; summing the
+// partials is exact, so the result does not depend on the thread count.
+void binEvents(const TelemetryBlock& events, std::vector<HeatMap>& partials, WorkerPool& pool) {
+    int slices = static_cast<int>(partials.size());
+    size_t perSlice = (events.size() + slices - 1) / slices;
+    pool.parallelFor(slices, 1, [&](int begin, int end) {
+        for (int s = begin; s < end; ++s) {
+            size_t first = std::min(events.size(), s * perSlice);
+            size_t last = std::min(events.size(), first + perSlice);
+            partials[s].add(events.data() + first, last - first);
+        }
+    });
+}
+
+// RaidPlanner class definition
+// Attacker AI. A worker thread folds battlefield observations into coarse
+// influence maps (defense coverage, interceptor density, decaying kill zones)
+// and re-plans the next wave from them: the cheapest entry/exit corridor
+// across the maps, with wave size and spacing adapted to how well the
+// defense is holding. The main thread only swaps data in and out.
+class RaidPlanner {
+public:
+    static const int COLS = 20;
+    static const int ROWS = 15;
+
+    struct Wave {
+        float startY = SCREEN_HEIGHT / 2.0f;
+        float endY = SCREEN_HEIGHT / 2.0f;
+        int count = 1;
+        float interval = 2.0f; // Seconds until the next wave
+    };
+
+    struct Observation {
+        std::vector<float> coverage;      // ROWS * COLS defense coverage counts
+        std::vector<float> missileX, missileY; // Missiles inside the attacker's sensor coverage
+        std::vector<float> killX, killY;
+        int leaks = 0;
+    };
+
+    RaidPlanner()
+        : coverage(ROWS * COLS, 0.0f),
+          density(ROWS * COLS, 0.0f),
+          killZones(ROWS * COLS, 0.0f),
+          random(static_cast<unsigned int>(std::rand())),
+          worker(&RaidPlanner::run, this) {}
+
+    ~RaidPlanner() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    // Hand over a new observation; replaces one the worker has not reached yet
+    void observe(Observation&& observation) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (hasPending) {
+                // Keep the events of the skipped observation
+                observation.killX.insert(observation.killX.end(), pending.killX.begin(), pending.killX.end());
+                observation.killY.insert(observation.killY.end(), pending.killY.begin(), pending.killY.end());
+                observation.leaks += pending.leaks;
+            }
+            pending = std::move(observation);
+            hasPending = true;
+        }
+        wake.notify_one();
+    }
+
+    Wave currentPlan() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return plan;
+    }
+
+private:
+    void run() {
+        Observation observation;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || hasPending; });
+                if (stopping) return;
+                std::swap(observation, pending);
+                hasPending = false;
+            }
+            integrate(observation);
+            Wave next = replan(observation);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                plan = next;
+            }
+        }
+    }
+
+    static int cellAt(float x, float y) {
+        int cx = std::min(std::max(static_cast<int>(x / SCREEN_WIDTH * COLS), 0), COLS - 1);
+        int cy = std::min(std::max(static_cast<int>(y / SCREEN_HEIGHT * ROWS), 0), ROWS - 1);
+        return cy * COLS + cx;
+    }
+
+    // Blend the observation into the maps instead of rebuilding them
+    void integrate(const Observation& observation) {
+        std::vector<float> missiles(ROWS * COLS, 0.0f);
+        for (size_t i = 0; i < observation.missileX.size(); ++i) {
+            missiles[cellAt(observation.missileX[i], observation.missileY[i])] += 1.0f;
+        }
+        for (int cell = 0; cell < ROWS * COLS; ++cell) {
+            coverage[cell] = observation.coverage[cell];
+            density[cell] = 0.8f * density[cell] + 0.2f * missiles[cell];
+            killZones[cell] *= 0.98f;
+        }
+        for (size_t i = 0; i < observation.killX.size(); ++i) {
+            killZones[cellAt(observation.killX[i], observation.killY[i])] += 1.0f;
+        }
+
+        // Pressure rises while the defense keeps killing and eases when raids leak
+        recentKills = 0.9f * recentKills + static_cast<float>(observation.killX.size());
+        recentLeaks = 0.9f * recentLeaks + static_cast<float>(observation.leaks);
+        if (recentKills > recentLeaks * 2.0f) {
+            pressure = std::min(pressure + 0.1f, 8.0f);
+        } else {
+            pressure = std::max(pressure - 0.05f, 0.0f);
+        }
+    }
+
+    // Score every straight corridor from a left-edge row to a right-edge row
+    // and pick among the cheapest with a softmax, so the attack stays adaptive
+    // without becoming predictable
+    Wave replan(const Observation&) {
+        std::vector<float> corridorCost(ROWS * ROWS);
+        float bestCost = std::numeric_limits<float>::max();
+        for (int entry = 0; entry < ROWS; ++entry) {
+            for (int exit = 0; exit < ROWS; ++exit) {
+                float cost = 0.0f;
+                for (int col = 0; col < COLS; ++col) {
+                    float t = (col + 0.5f) / COLS;
+                    int row = static_cast<int>(entry + (exit - entry) * t + 0.5f);
+                    int cell = row * COLS + col;
+                    cost += 1.0f * coverage[cell] + 2.0f * density[cell] + 4.0f * killZones[cell];
+                }
+                corridorCost[entry * ROWS + exit] = cost;
+                bestCost = std::min(bestCost, cost);
+            }
+        }
+
+        std::vector<double> weights(corridorCost.size());
+        for (size_t i = 0; i < corridorCost.size(); ++i) {
+            weights[i] = std::exp(-(corridorCost[i] - bestCost) / 2.0f);
+        }
+        std::discrete_distribution<int> pick(weights.begin(), weights.end());
+        int corridor = pick(random);
+
+        float rowHeight = SCREEN_HEIGHT / ROWS;
+        Wave wave;
+        wave.startY = (corridor / ROWS + 0.5f) * rowHeight;
+        wave.endY = (corridor % ROWS + 0.5f) * rowHeight;
+        wave.count = 1 + static_cast<int>(pressure);
+        wave.interval = 2.0f / (1.0f + pressure * 0.25f);
+        return wave;
+    }
+
+    // Worker-owned influence maps
+    std::vector<float> coverage;
+    std::vector<float> density;
+    std::vector<float> killZones;
+    float recentKills = 0.0f;
+    float recentLeaks = 0.0f;
+    float pressure = 0.0f;
+    std::minstd_rand random;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    Observation pending;
+    bool hasPending = false;
+    bool stopping = false;
+    Wave plan;
+    std::thread worker; // Declared last so it starts after the state above exists
+};
+
+// FrameEncoder class definition
+// Background encoder pool for recorded frames. The simulation thread copies
+// a rendered frame into a pooled RGB buffer and submits it; worker threads
+// encode frames concurrently. PPM frames go to one numbered file each; Y4M
+// frames are converted to 4:2:0 in parallel and appended to a single stream
+// in frame order (ffmpeg reads either). Submitting only blocks when every
+// pooled buffer is still queued, which bounds memory.
+class FrameEncoder {
+public:
+    enum Format { PPM, Y4M };
+
+    // The frame rate is the rational rateNumerator / rateDenominator frames per second
+    FrameEncoder(const std::string& path, Format format, int width, int height, int rateNumerator,
+                 int rateDenominator, int workerCount, int bufferCount)
+        : path(path), format(format), width(width), height(height) {
+        if (format == Y4M) {
+            stream.open(path, std::ios::binary);
+            stream << "YUV4MPEG2 W" << width << " H" << height << " F" << rateNumerator << ":" << rateDenominator
+                   << " Ip A1:1 C420jpeg\n";
+        }
+        for (int i = 0; i < bufferCount; ++i) {
+            freeBuffers.emplace_back(new std::vector<unsigned char>(width * height * 3));
+        }
+        for (int i = 0; i < workerCount; ++i) {
+            workers.emplace_back(&FrameEncoder::run, this);
+        }
+    }
+
+    ~FrameEncoder() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    bool isOpen() const { return format == PPM || static_cast<bool>(stream); }
+
+    // Take a free RGB buffer, waiting for the encoders if all are in flight
+    std::unique_ptr<std::vector<unsigned char>> acquireBuffer() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeBuffers.empty()) {
+            Clock::time_point start = Clock::now();
+            bufferReturned.wait(lock, [this] { return !freeBuffers.empty(); });
+            stallSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        std::unique_ptr<std::vector<unsigned char>> buffer = std::move(freeBuffers.back());
+        freeBuffers.pop_back();
+        return buffer;
+    }
+
+    void submit(std::unique_ptr<std::vector<unsigned char>> rgb) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push(Job{nextFrame++, std::move(rgb)});
+        }
+        wake.notify_one();
+    }
+
+    // Block until every submitted frame is on disk
+    void finish() {
+        std::unique_lock<std::mutex> lock(mutex);
+        bufferReturned.wait(lock, [this] { return pending.empty() && written == nextFrame; });
+        if (stream) stream.flush();
+    }
+
+    long framesWritten() const { return written; }
+    double getStallSeconds() const { return stallSeconds; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Job {
+        long frame;
+        std::unique_ptr<std::vector<unsigned char>> rgb;
+    };
+
+    void run() {
+        std::vector<unsigned char> planes;
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (pending.empty()) return;
+                job = std::move(pending.front());
+                pending.pop();
+            }
+
+            if (format == PPM) {
+                writePpm(job.frame, *job.rgb);
+                recycle(std::move(job.rgb));
+                std::lock_guard<std::mutex> lock(mutex);
+                ++written;
+            } else {
+                toYuv420(*job.rgb, planes);
+                recycle(std::move(job.rgb));
+                appendInOrder(job.frame, planes);
+            }
+            bufferReturned.notify_all();
+        }
+    }
+
+    void recycle(std::unique_ptr<std::vector<unsigned char>> buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.push_back(std::move(buffer));
+    }
+
+    void writePpm(long frame, const std::vector<unsigned char>& rgb) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "_%06ld.ppm", frame);
+        std::ofstream file(path + name, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to write frame " << path << name << std::endl;
+            return;
+        }
+        file << "P6\n" << width << " " << height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    }
+
+    // Full-range BT.601 (the "jpeg" colour range in the stream header), chroma averaged over 2x2 blocks
+    void toYuv420(const std::vector<unsigned char>& rgb, std::vector<unsigned char>& planes) const {
+        const int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+        planes.resize(width * height + 2 * chromaWidth * chromaHeight);
+        unsigned char* lumaPlane = planes.data();
+        unsigned char* uPlane = lumaPlane + width * height;
+        unsigned char* vPlane = uPlane + chromaWidth * chromaHeight;
+        for (int i = 0; i < width * height; ++i) {
+            const unsigned char* p = &rgb[i * 3];
+            lumaPlane[i] = static_cast<unsigned char>((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+        }
+        for (int cy = 0; cy < chromaHeight; ++cy) {
+            for (int cx = 0; cx < chromaWidth; ++cx) {
+                int r = 0, g = 0, b = 0, samples = 0;
+                for (int y = cy * 2; y < std::min(cy * 2 + 2, height); ++y) {
+                    for (int x = cx * 2; x < std::min(cx * 2 + 2, width); ++x) {
+                        const unsigned char* p = &rgb[(y * width + x) * 3];
+                        r += p[0];
+                        g += p[1];
+                        b += p[2];
+                        ++samples;
+                    }
+                }
+                r /= samples;
+                g /= samples;
+                b /= samples;
+                uPlane[cy * chromaWidth + cx] = static_cast<unsigned char>((-43 * r - 85 * g + 128 * b + 32768) >> 8);
+                vPlane[cy * chromaWidth + cx] = static_cast<unsigned char>((128 * r - 107 * g - 21 * b + 32768) >> 8);
+            }
+        }
+    }
+
+    // Park converted frames until every earlier frame is written, then append the run
+    void appendInOrder(long frame, std::vector<unsigned char>& planes) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        converted[frame].swap(planes);
+        while (!converted.empty() && converted.begin()->first == nextToWrite) {
+            stream << "FRAME\n";
+            stream.write(reinterpret_cast<const char*>(converted.begin()->second.data()), converted.begin()->second.size());
+            converted.erase(converted.begin());
+            ++nextToWrite;
+            std::lock_guard<std::mutex> countLock(mutex);
+            ++written;
+        }
+    }
+
+    std::string path;
+    Format format;
+    int width, height;
+    std::ofstream stream; // Y4M only
+
+    std::mutex mutex; // Guards the queue, the buffer pool and the counters
+    std::condition_variable wake, bufferReturned;
+    std::queue<Job> pending;
+    std::vector<std::unique_ptr<std::vector<unsigned char>>> freeBuffers;
+    long nextFrame = 0;
+    long written = 0;
+    double stallSeconds = 0.0;
+    bool stopping = false;
+
+    std::mutex writeMutex; // Guards the Y4M reorder buffer and the stream
+    std::map<long, std::vector<unsigned char>> converted;
+    long nextToWrite = 0;
+
+    std::vector<std::thread> workers; // Declared last so they start after the state above exists
+};
+
+// Function declarations
+void updateEntities(float deltaTime);
+void drawEntities();
+void launchMissile(float startX, float startY, std::shared_ptr<EnemyTarget> target); // No mutex lock inside
+void launchFromNearestLauncher(std::shared_ptr<EnemyTarget> target); // No mutex lock inside
+Vec2 nearestLaunchPoint(const EnemyTarget& target); // No mutex lock inside
+void spawnTargets(const TargetSpawn* spawns, size_t count);
+void launchSalvo(const SalvoShot* shots, size_t count);
+void generateTerrain();
+void toggleObstacle(float x, float y);
+void drawTerrain();
+void spawnWave(const RaidPlanner::Wave& wave);
+void observeBattlefield(RaidPlanner& planner);
+void detectionTask();
+void drawDetectionRange();
+void drawPredictedTrajectory(const EnemyTarget& target);
+void selectInBox(float x0, float y0, float x1, float y1);
+void selectAt(float x, float y);
+void commandAt(float x, float y);
+void fireAtSelection();
+void drawSelection();
+int pickVisibleTarget(float x, float y); // No mutex lock inside
+void deployDefenses();
+int runBenchmarks();
+int runVerification();
+void scriptedBattleTick(long tick);
+int runDigest(long ticks, const char* outPath, const char* comparePath);
+int runRecording(long ticks, const char* path, int frameInterval, FrameEncoder::Format format);
+int runAnalysis(const char* path, const char* outPrefix);
+int runFuzz(int cases, unsigned int seed);
+
+int main(int argc, char** argv) {
+    // Command-line options
+    bool benchmark = false;
+    bool verify = false;
+    unsigned int seed = static_cast<unsigned int>(std::time(nullptr));
+    long ticks = 3600;
+    const char* digestOut = nullptr;
+    const char* digestCompare = nullptr;
+    int fuzzCases = 0;
+    const char* recordPath = nullptr;
+    int recordEvery = 1;
+    FrameEncoder::Format recordFormat = FrameEncoder::PPM;
+    const char* analyzePath = nullptr;
+    int metricsPort = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--wind") == 0 && i + 1 < argc) {
+            if (!windField.load(argv[++i])) return -1;
+        } else if (std::strcmp(argv[i], "--bench") == 0) {
+            benchmark = true;
+        } else if (std::strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzzCases = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--digest-out") == 0 && i + 1 < argc) {
+            digestOut = argv[++i];
+        } else if (std::strcmp(argv[i], "--digest-compare") == 0 && i + 1 < argc) {
+            digestCompare = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--record-every") == 0 && i + 1 < argc) {
+            recordEvery = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* format = argv[++i];
+            if (std::strcmp(format, "y4m") == 0) {
+                recordFormat = FrameEncoder::Y4M;
+            } else if (std::strcmp(format, "ppm") == 0) {
+                recordFormat = FrameEncoder::PPM;
+            } else {
+                std::cerr << "Unknown recording format " << format << " (expected ppm or y4m)" << std::endl;
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--telemetry-out") == 0 && i + 1 < argc) {
+            if (!telemetry.open(argv[++i])) {
+                std::cerr << "Failed to create telemetry file " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--analyze") == 0 && i + 1 < argc) {
+            analyzePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--event-log") == 0 && i + 1 < argc) {
+            if (!eventLog.open(argv[++i])) {
+                std::cerr << "Failed to create event log " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--trail-every") == 0 && i + 1 < argc) {
+            // Targets are sampled at the given interval, the faster missiles twice as often
+            int interval = std::atoi(argv[++i]);
+            targetTrails.setSampleInterval(interval);
+            missileTrails.setSampleInterval(interval / 2);
+        } else if (std::strcmp(argv[i], "--huge-pages") == 0) {
+            HugePages::enabled() = true;
+        } else if (std::strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            metricsPort = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            std::cerr << "Usage: missile_simulation [--wind <file>] [--seed <n>] [--bench] [--verify]" << std::endl;
+            std::cerr << "       [--fuzz <cases>] [--digest-out <file>] [--digest-compare <file>] [--ticks <n>]" << std::endl;
+            std::cerr << "       [--record <prefix>] [--record-every <n>] [--format ppm|y4m]" << std::endl;
+            std::cerr << "       [--telemetry-out <file>] [--analyze <file>] [--event-log <file>] [--metrics-port <port>]"
+                      << std::endl;
+            std::cerr << "       [--trail-every <ticks>] [--huge-pages]" << std::endl;
+            return -1;
+        }
+    }
+    // On multi-node machines, entity arrays are placed where they will be updated
+    if (numaTopology.nodeCount() > 1) firstTouchHook() = numaFirstTouch;
+    if (metricsPort > 0 && !metricsServer.start(metricsPort)) {
+        std::cerr << "Failed to serve metrics on port " << metricsPort << std::endl;
+        return -1;
+    }
+    // Engagement envelope, needed by detectionTask and the checks below
+    launchTable.build();
+
+    if (benchmark) {
+        return runBenchmarks();
+    }
+    if (verify) {
+        return runVerification();
+    }
+    if (fuzzCases > 0) {
+        return runFuzz(fuzzCases, seed);
+    }
+    if (analyzePath) {
+        return runAnalysis(analyzePath, analyzePath);
+    }
+    std::srand(seed);
+    if (digestOut || digestCompare) {
+        return runDigest(ticks, digestOut, digestCompare);
+    }
+    if (recordPath) {
+        return runRecording(ticks, recordPath, recordEvery, recordFormat);
+    }
+
+    // Initialize Allegro
+    if (!al_init()) {
+        std::cerr << "Failed to initialize Allegro!" << std::endl;
+        return -1;
+    }
+
+    // Initialize addons
+    if (!al_init_primitives_addon()) {
+        std::cerr << "Failed to initialize primitives addon!" << std::endl;
+        return -1;
+    }
+    if (!al_install_keyboard()) {
+        std::cerr << "Failed to initialize keyboard!" << std::endl;
+        return -1;
+    }
+    if (!al_install_mouse()) {
+        std::cerr << "Failed to initialize mouse!" << std::endl;
+        return -1;
+    }
+    al_init_font_addon();
+    al_init_ttf_addon();
+
+    // Create display
+    ALLEGRO_DISPLAY* display = al_create_display(static_cast<int>(SCREEN_WIDTH), static_cast<int>(SCREEN_HEIGHT));
+    if (!display) {
+        std::cerr << "Failed to create display!" << std::endl;
+        return -1;
+    }
+
+    // Load font
+    ALLEGRO_FONT* font = al_create_builtin_font();
+    if (!font) {
+        std::cerr << "Failed to create font!" << std::endl;
+        al_destroy_display(display);
+        return -1;
+    }
+
+    // Create event queue and timer
+    ALLEGRO_EVENT_QUEUE* event_queue = al_create_event_queue();
+    ALLEGRO_TIMER* timer = al_create_timer(1.0 / FPS);
+
+    // Register event sources
+    al_register_event_source(event_queue, al_get_display_event_source(display));
+    al_register_event_source(event_queue, al_get_timer_event_source(timer));
+    al_register_event_source(event_queue, al_get_keyboard_event_source());
+    al_register_event_source(event_queue, al_get_mouse_event_source());
+
+    // Start the timer
+    al_start_timer(timer);
+
+    // Lay out the terrain and deploy the launcher battery around the sensor
+    generateTerrain();
+    deployDefenses();
+
+    // Main loop variables
+    bool running = true;
+    bool redraw = true;
+    float mouseX = 0.0f;
+    float mouseY = 0.0f;
+
+    // Attacker AI, re-planning on its own thread from what we observe
+    RaidPlanner raidPlanner;
+    RaidPlanner::Wave raidPlan = raidPlanner.currentPlan();
+
+    // Timers
+    float enemySpawnTimer = 0.0f;
+
+    float detectionTimer = 0.0f;
+    const float detectionInterval = 0.5f; // Check every 0.5 seconds
+    int64_t simulatedTicks = 0;
+
+    while (running) {
+        ALLEGRO_EVENT ev;
+        al_wait_for_event(event_queue, &ev);
+
+        if (ev.type == ALLEGRO_EVENT_TIMER) {
+            // Update simulation
+            auto tickStart = std::chrono::steady_clock::now();
+            float deltaTime = 1.0f / FPS;
+            beginTick();
+
+            // Launch the planner's next wave when it is due
+            enemySpawnTimer += deltaTime;
+            if (enemySpawnTimer >= raidPlan.interval) {
+                enemySpawnTimer = 0.0f;
+                spawnWave(raidPlan);
+                raidPlan = raidPlanner.currentPlan();
+            }
+
+            // Update detection timer
+            detectionTimer += deltaTime;
+            if (detectionTimer >= detectionInterval) {
+                detectionTimer -= detectionInterval;
+                detectionTask();
+                observeBattlefield(raidPlanner);
+            }
+
+            // Update entities
+            updateEntities(deltaTime);
+            ++simulatedTicks;
+            ticksTotal.add();
+            tickSeconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - tickStart).count());
+            tickBacklog.set(static_cast<double>(al_get_timer_count(timer) - simulatedTicks));
+
+            redraw = true;
+        }
+        else if (ev.type == ALLEGRO_EVENT_DISPLAY_CLOSE) {
+            running = false;
+        }
+        else if (ev.type == ALLEGRO_EVENT_KEY_DOWN) {
+            if (ev.keyboard.keycode == ALLEGRO_KEY_ESCAPE)
+                running = false;
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_SPACE) {
+                // Launch missiles at the selected targets (or the first target)
+                fireAtSelection();
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_T) {
+                // Toggle flight-history trails
+                showTrails = !showTrails;
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_O) {
+                // Toggle an impassable obstacle under the cursor
+                toggleObstacle(mouseX, mouseY);
+            }
+            else if (ev.keyboard.keycode == ALLEGRO_KEY_J) {
+                // Add a stand-off jammer under the cursor
+                std::lock_guard<std::mutex> lock(dataMutex);
+                jammerField.add(mouseX, mouseY, 20.0f, 4.0e6f);
+            }
+        }
+        else if (ev.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) {
+            if (ev.mouse.button == 1) {
+                // Start a selection box
+                selection.dragging = true;
+                selection.dragStartX = selection.dragEndX = static_cast<float>(ev.mouse.x);
+                selection.dragStartY = selection.dragEndY = static_cast<float>(ev.mouse.y);
+            }
+            else if (ev.mouse.button == 2) {
+                // Retarget or launch at the clicked target, or move selected launchers
+                commandAt(static_cast<float>(ev.mouse.x), static_cast<float>(ev.mouse.y));
+            }
+        }
+        else if (ev.type == ALLEGRO_EVENT_MOUSE_AXES) {
+            mouseX = static_cast<float>(ev.mouse.x);
+            mouseY = static_cast<float>(ev.mouse.y);
+            if (selection.dragging) {
+                selection.dragEndX = static_cast<float>(ev.mouse.x);
+                selection.dragEndY = static_cast<float>(ev.mouse.y);
+            }
+        }
+        else if (ev.type == ALLEGRO_EVENT_MOUSE_BUTTON_UP) {
+            if (ev.mouse.button == 1 && selection.dragging) {
+                selection.dragging = false;
+                selection.dragEndX = static_cast<float>(ev.mouse.x);
+                selection.dragEndY = static_cast<float>(ev.mouse.y);
+
+                // A drag of a few pixels is treated as a click
+                if (std::fabs(selection.dragEndX - selection.dragStartX) < 4.0f &&
+                    std::fabs(selection.dragEndY - selection.dragStartY) < 4.0f) {
+                    selectAt(selection.dragEndX, selection.dragEndY);
+                } else {
+                    selectInBox(selection.dragStartX, selection.dragStartY,
+                                selection.dragEndX, selection.dragEndY);
+                }
+            }
+        }
+
+        if (redraw && al_is_event_queue_empty(event_queue)) {
+            redraw = false;
+
+            // Clear screen
+            al_clear_to_color(al_map_rgb(0, 0, 0));
+
+            // Draw entities
+            drawEntities();
+            drawSelection();
+
+            // Draw HUD
+            al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 10, 0, "Targets: %zu", enemyTargets.size());
+            al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 30, 0, "Missiles: %zu", defenseMissiles.size());
+            al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 50, 0, "Selected: %zu targets, %zu missiles, %zu launchers",
+                          selection.targets.size(), selection.missiles.size(), selection.launchers.size());
+            al_draw_text(font, al_map_rgb(255, 255, 255), 10, 70, 0, "Press SPACE to manually launch a missile.");
+            al_draw_text(font, al_map_rgb(255, 255, 255), 10, 90, 0, "Drag to select, right-click a target to retarget or fire.");
+            al_draw_text(font, al_map_rgb(255, 255, 255), 10, 110, 0, "Right-click ground to move launchers, O toggles an obstacle.");
+            al_draw_text(font, al_map_rgb(255, 255, 255), 10, 130, 0, "T toggles flight-history trails, J adds a jammer at the cursor.");
+            al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 150, 0, "Radar: %zu tracks, load %.0f%%, %d dwells dropped",
+                          radar.trackCount(), radar.getLoad() * 100.0f, radar.getDropped());
+            al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 170, 0, "Targets rejected as out of reach: %ld",
+                          engineStats.total(STAT_REJECTED_TARGETS));
+
+            // Flip display
+            al_flip_display();
+        }
+    }
+
+    // Clean up
+    al_destroy_font(font);
+    al_destroy_timer(timer);
+    al_destroy_event_queue(event_queue);
+    al_destroy_display(display);
+
+    return 0;
+}
+
+// Function implementations
+
+// Update all entities
+void updateEntities(float deltaTime) {
+    std::unique_lock<std::mutex> lock(dataMutex);
+    const long tick = simulationTick; // Begun by beginTick
+    windField.setTime(tick * deltaTime);
+    if (tick % static_cast<long>(FPS) == 0) eventLog.flush(); // At most a second of events unwritten
+
+    // Update enemy targets
+    static EnvironmentSamples environment;
+    sampleEnvironment(targetStore.position, environment);
+    integrateTargets(deltaTime, environment);
+
+    // Update defense missiles and their exhaust trails
+    sampleEnvironment(missileStore.position, environment);
+    integrateMissiles(deltaTime, environment);
+    for (size_t i = 0; i < missileStore.size(); ++i) {
+        if (missileStore.active[i]) {
+            particles.smoke(missileStore.position.x[i], missileStore.position.y[i]);
+        } else {
+            // Collisions only come later, so every missile lost here missed
+            telemetry.record(tick, TelemetryEvent::MISS, missileStore.position.x[i], missileStore.position.y[i]);
+        }
+    }
+    particles.update(deltaTime);
+
+    // Jammers patrol; their range tables catch up lazily at the next scan
+    jammerField.update(deltaTime);
+
+    // Move launchers along their flow fields
+    for (auto& launcher : launchers) {
+        launcher->update(deltaTime);
+    }
+
+    // Collision detection: Mark missiles and targets as inactive upon collision
+    static std::vector<int> hits;
+    detectCollisions(hits);
+    for (int slot : hits) {
+        auto targetPtr = defenseMissiles[slot]->target.lock();
+        if (!targetPtr->isActiveTarget()) continue; // An earlier missile got it this tick
+
+        defenseMissiles[slot]->setInactive();
+        targetPtr->setInactive();
+        particles.explosion(targetPtr->getX(), targetPtr->getY());
+        battleReport.killX.push_back(targetPtr->getX());
+        battleReport.killY.push_back(targetPtr->getY());
+        telemetry.record(tick, TelemetryEvent::INTERCEPT, targetPtr->getX(), targetPtr->getY());
+        engineStats.add(STAT_KILLS);
+        eventLog.append(EVENT_INTERCEPT, defenseMissiles[slot]->getID(), targetPtr->getID(), targetPtr->getX(),
+                        targetPtr->getY());
+    }
+
+    // Keep sensor coverage in step with movement; dying targets release theirs
+    for (auto& target : enemyTargets) {
+        if (target->isActiveTarget()) {
+            visibility[SIDE_ATTACK].updateSensor(target->footprint, target->getX(), target->getY(), TARGET_SENSOR_RANGE);
+        } else {
+            visibility[SIDE_ATTACK].removeSensor(target->footprint);
+            if (target->getX() > SCREEN_WIDTH) {
+                engineStats.add(STAT_LEAKS); // Reached the defended edge
+                telemetry.record(tick, TelemetryEvent::LEAK, target->getX(), target->getY());
+                eventLog.append(EVENT_LEAK, target->getID(), -1, target->getX(), target->getY());
+                particles.impact(SCREEN_WIDTH, target->getY());
+            }
+        }
+    }
+    for (auto& launcher : launchers) {
+        visibility[SIDE_DEFENSE].updateSensor(launcher->footprint, launcher->getX(), launcher->getY(), LAUNCHER_SENSOR_RANGE);
+        if (launcher->sensorId >= 0) sensorNetwork.moveSensor(launcher->sensorId, launcher->getX(), launcher->getY());
+    }
+
+    // Sample flight history; removed entities hand their trail slot back.
+    // Targets are only tracked while the defense can see them.
+    bool sampleTargets = targetTrails.isSampleTick(tick);
+    for (auto& target : enemyTargets) {
+        if (!target->isActiveTarget()) {
+            targetTrails.release(target->trailSlot);
+            target->trailSlot = -1;
+        } else if (sampleTargets && visibility[SIDE_DEFENSE].isVisible(target->getX(), target->getY())) {
+            if (target->trailSlot < 0) target->trailSlot = targetTrails.acquire();
+            if (target->trailSlot >= 0) targetTrails.record(target->trailSlot, target->getX(), target->getY());
+        }
+    }
+    bool sampleMissiles = missileTrails.isSampleTick(tick);
+    for (auto& missile : defenseMissiles) {
+        if (!missile->isActiveMissile()) {
+            missileTrails.release(missile->trailSlot);
+            missile->trailSlot = -1;
+        } else if (sampleMissiles) {
+            if (missile->trailSlot < 0) missile->trailSlot = missileTrails.acquire();
+            if (missile->trailSlot >= 0) missileTrails.record(missile->trailSlot, missile->getX(), missile->getY());
+        }
+    }
+
+    // Remove inactive targets and missiles along with their store slots
+    compactEntities(enemyTargets, targetStore);
+    compactEntities(defenseMissiles, missileStore);
+    targetsActive.set(static_cast<double>(enemyTargets.size()));
+    missilesInFlight.set(static_cast<double>(defenseMissiles.size()));
+
+    // Re-index survivors for selection and picking queries
+    targetGrid.rebuild(enemyTargets);
+    missileGrid.rebuild(defenseMissiles);
+    launcherGrid.rebuild(launchers);
+    worldQuery.capture(tick);
+    endStatsPhase();
+    lock.unlock();
+    worldQuery.publish();
+}
+
+// Draw all entities
+void drawEntities() {
+    // Draw terrain and detection range
+    drawTerrain();
+    drawDetectionRange();
+
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    // Draw flight history
+    if (showTrails) {
+        targetTrails.draw(255, 120, 120);
+        missileTrails.draw(120, 255, 120);
+    }
+
+    // Draw launchers
+    for (const auto& launcher : launchers) {
+        launcher->draw();
+    }
+
+    // Draw enemy targets and their predicted trajectories (only those the defense sees)
+    for (const auto& target : enemyTargets) {
+        if (!visibility[SIDE_DEFENSE].isVisible(target->getX(), target->getY())) continue;
+        target->draw();
+        drawPredictedTrajectory(*target);
+    }
+
+    // Draw defense missiles
+    for (const auto& missile : defenseMissiles) {
+        missile->draw();
+    }
+
+    // Draw effects in one batch
+    particles.draw();
+}
+
+// Launch a missile towards a target
+void launchMissile(float startX, float startY, std::shared_ptr<EnemyTarget> target) {
+    // Assume dataMutex is locked by the caller
+    addMissile(Vec2(startX, startY), target, MISSILE_LAUNCH_SPEED);
+}
+
+// Position of the launcher closest to the target, or of the sensor if none exist
+Vec2 nearestLaunchPoint(const EnemyTarget& target) {
+    // Assume dataMutex is locked by the caller
+    Vec2 start(SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f);
+    float bestDistSq = std::numeric_limits<float>::max();
+    for (const auto& launcher : launchers) {
+        Vec2 launcherPosition(launcher->getX(), launcher->getY());
+        float distSq = (launcherPosition - target.getPosition()).lengthSquared();
+        if (distSq < bestDistSq) {
+            bestDistSq = distSq;
+            start = launcherPosition;
+        }
+    }
+    return start;
+}
+
+// Launch from the launcher closest to the target
+void launchFromNearestLauncher(std::shared_ptr<EnemyTarget> target) {
+    // Assume dataMutex is locked by the caller
+    Vec2 start = nearestLaunchPoint(*target);
+    launchMissile(start.x, start.y, target);
+}
+
+// Make room for count more elements. Growing to at least twice the capacity
+// keeps repeated small batches amortized; reserving the exact size would
+// reallocate on every batch.
+template <typename Container>
+void reserveForBatch(Container& container, size_t count) {
+    size_t needed = container.size() + count;
+    if (container.capacity() < needed) container.reserve(std::max(2 * container.capacity(), needed));
+}
+
+// Add a batch of targets under one lock: the store grows once and is filled
+// in place, the handles come from pooled nodes, the spawns are logged in one
+// append, and the target grid is re-indexed once at the end so the new
+// targets can be picked straight away
+void spawnTargets(const TargetSpawn* spawns, size_t count) {
+    static std::vector<EventRecord> records; // Guarded by dataMutex
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    size_t first = targetStore.size();
+    reserveForBatch(enemyTargets, count);
+    reserveForBatch(targetStore, count);
+    targetStore.resize(first + count);
+    for (size_t i = 0; i < count; ++i) {
+        targetStore.position.set(first + i, spawns[i].position);
+        targetStore.velocity.set(first + i, spawns[i].velocity);
+        targetStore.active[first + i] = 1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        enemyTargets.push_back(std::allocate_shared<EnemyTarget>(PoolAllocator<EnemyTarget>(), static_cast<int>(first + i)));
+    }
+
+    if (eventLog.isOpen()) {
+        records.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            records[i] = EventRecord{0, EVENT_SPAWN, 0, enemyTargets[first + i]->getID(), -1,
+                                     spawns[i].position.x, spawns[i].position.y};
+        }
+        eventLog.append(records.data(), count);
+    }
+    targetGrid.rebuild(enemyTargets);
+}
+
+// Fire a batch of missiles under one lock, see spawnTargets. The store is
+// filled before the handles exist because each missile aims on construction.
+void launchSalvo(const SalvoShot* shots, size_t count) {
+    static std::vector<EventRecord> records; // Guarded by dataMutex
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    size_t first = missileStore.size();
+    reserveForBatch(defenseMissiles, count);
+    reserveForBatch(missileStore, count);
+    missileStore.resize(first + count);
+    for (size_t i = 0; i < count; ++i) {
+        missileStore.position.set(first + i, shots[i].launchPoint);
+        missileStore.velocity.set(first + i, Vec2());
+        missileStore.speed[first + i] = MISSILE_LAUNCH_SPEED;
+        missileStore.flightTime[first + i] = 0.0f;
+        missileStore.active[first + i] = 1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        defenseMissiles.push_back(std::allocate_shared<DefenseMissile>(PoolAllocator<DefenseMissile>(),
+                                                                      static_cast<int>(first + i), shots[i].target));
+    }
+    engineStats.add(STAT_LAUNCHES, static_cast<long>(count));
+
+    if (eventLog.isOpen()) {
+        records.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            records[i] = EventRecord{0, EVENT_LAUNCH, 0, defenseMissiles[first + i]->getID(),
+                                     shots[i].target ? shots[i].target->getID() : -1,
+                                     shots[i].launchPoint.x, shots[i].launchPoint.y};
+        }
+        eventLog.append(records.data(), count);
+    }
+    missileGrid.rebuild(defenseMissiles);
+}
+
+// Detection task to detect targets within sensor coverage and launch missiles
+void detectionTask() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    static long pass = 0;
+
+    // targetGrid was rebuilt at the end of the last update, so it indexes enemyTargets as they stand.
+    // Launcher sensors see everything in their short range; the radar only what its budget allows.
+    sensorNetwork.scan(pass++, targetGrid, jammerField, workerPool);
+    radar.scanFrame(targetGrid, enemyTargets, jammerField);
+    stampRadarCoverage();
+    radarTracks.set(static_cast<double>(radar.trackCount()));
+    radarLoad.set(radar.getLoad());
+    const std::vector<int>& local = sensorNetwork.getDetected();
+    const std::vector<int>& tracked = radar.getConfirmed();
+    std::vector<int> detected;
+    detected.reserve(local.size() + tracked.size());
+    std::set_union(local.begin(), local.end(), tracked.begin(), tracked.end(), std::back_inserter(detected));
+    if (eventLog.isOpen()) {
+        for (int index : detected) {
+            const auto& target = enemyTargets[index];
+            eventLog.append(EVENT_DETECTION, target->getID(), -1, target->getX(), target->getY());
+        }
+    }
+
+    // Launch at the first detected target a missile can actually reach;
+    // shots outside the launch table's envelope are not worth an interceptor
+    for (int index : detected) {
+        const auto& target = enemyTargets[index];
+        if (!launchTable.feasible(nearestLaunchPoint(*target), target->getPosition(), target->getVelocity())) {
+            if (!target->rejected) engineStats.add(STAT_REJECTED_TARGETS); // Once per target, not per pass
+            target->rejected = true;
+            continue;
+        }
+        // Target detected, launch missile
+        // For simplicity, launch at one target per pass
+        launchFromNearestLauncher(target);
+        break;
+    }
+    endStatsPhase();
+}
+
+// Draw the detection range
+void drawDetectionRange() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    // Radar coverage as left by the jamming, one segment per table sector
+    const JamTable& table = radar.getJamTable();
+    float previousX = 0.0f, previousY = 0.0f;
+    for (int sector = 0; sector <= JamTable::SECTORS; ++sector) {
+        int index = sector % JamTable::SECTORS;
+        float angle = (index + 0.5f) * (2.0f * MATH_PI / JamTable::SECTORS) - MATH_PI;
+        float sine, cosine;
+        EngineMath::sinCos(angle, sine, cosine);
+        float x = radar.getX() + cosine * table.sectorRangeAt(index);
+        float y = radar.getY() + sine * table.sectorRangeAt(index);
+        if (sector > 0) al_draw_line(previousX, previousY, x, y, al_map_rgb(0, 0, 255), 1);
+        previousX = x;
+        previousY = y;
+    }
+
+    // Jammers
+    for (const auto& jammer : jammerField.getJammers()) {
+        al_draw_filled_triangle(jammer.x, jammer.y - 8, jammer.x - 7, jammer.y + 6, jammer.x + 7, jammer.y + 6,
+                                al_map_rgb(255, 0, 255));
+    }
+}
+
+// Draw predicted trajectory of an enemy target
+void drawPredictedTrajectory(const EnemyTarget& target) {
+    float predictionTime = 5.0f; // Predict 5 seconds into the future
     float deltaTime = 0.5f; // Draw a point every 0.5 seconds
     float currentTime = 0.0f;
 
-    float x = target.getX();
-    float y = target.getY();
-    float speedX = target.getSpeedX();
-    float speedY = target.getSpeedY();
+    Vec2 position = target.getPosition();
+    Vec2 step = target.getVelocity() * deltaTime;
+
+    while (currentTime < predictionTime) {
+        position += step;
+        al_draw_filled_circle(position.x, position.y, 2, al_map_rgb(255, 255, 0));
+        currentTime += deltaTime;
+    }
+}
+
+// Replace the selection with every target, missile and launcher inside the box
+void selectInBox(float x0, float y0, float x1, float y1) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    selection.targets.clear();
+    selection.missiles.clear();
+    selection.launchers.clear();
+    targetGrid.queryRect(x0, y0, x1, y1, [](int i) {
+        if (visibility[SIDE_DEFENSE].isVisible(enemyTargets[i]->getX(), enemyTargets[i]->getY())) {
+            selection.targets.push_back(enemyTargets[i]);
+        }
+    });
+    missileGrid.queryRect(x0, y0, x1, y1, [](int i) {
+        selection.missiles.push_back(defenseMissiles[i]);
+    });
+    launcherGrid.queryRect(x0, y0, x1, y1, [](int i) {
+        selection.launchers.push_back(launchers[i]);
+    });
+}
+
+// Index of the target under the cursor, ignoring targets hidden from the defense
+int pickVisibleTarget(float x, float y) {
+    // Assume dataMutex is locked by the caller
+    int targetIndex = targetGrid.findNearest(x, y, PICK_RADIUS);
+    if (targetIndex >= 0 &&
+        !visibility[SIDE_DEFENSE].isVisible(enemyTargets[targetIndex]->getX(), enemyTargets[targetIndex]->getY())) {
+        return -1;
+    }
+    return targetIndex;
+}
+
+// Replace the selection with the entity under the cursor (launchers, then targets)
+void selectAt(float x, float y) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    selection.targets.clear();
+    selection.missiles.clear();
+    selection.launchers.clear();
+    int launcherIndex = launcherGrid.findNearest(x, y, PICK_RADIUS);
+    if (launcherIndex >= 0) {
+        selection.launchers.push_back(launchers[launcherIndex]);
+        return;
+    }
+    int targetIndex = pickVisibleTarget(x, y);
+    if (targetIndex >= 0) {
+        selection.targets.push_back(enemyTargets[targetIndex]);
+        return;
+    }
+    int missileIndex = missileGrid.findNearest(x, y, PICK_RADIUS);
+    if (missileIndex >= 0) {
+        selection.missiles.push_back(defenseMissiles[missileIndex]);
+    }
+}
+
+// Right-click command: selected missiles are retargeted onto the clicked
+// target; with no missiles selected a new missile is launched at it. Clicking
+// open ground sends the selected launchers there.
+void commandAt(float x, float y) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    int targetIndex = pickVisibleTarget(x, y);
+    if (targetIndex < 0) {
+        for (const auto& weakLauncher : selection.launchers) {
+            if (auto launcher = weakLauncher.lock()) {
+                launcher->moveTo(x, y);
+            }
+        }
+        return;
+    }
+    auto target = enemyTargets[targetIndex];
+    if (!target->isActiveTarget()) return;
+
+    bool retargeted = false;
+    for (const auto& weakMissile : selection.missiles) {
+        if (auto missile = weakMissile.lock()) {
+            if (missile->isActiveMissile()) {
+                missile->retarget(target);
+                eventLog.append(EVENT_RETARGET, missile->getID(), target->getID(), missile->getX(), missile->getY());
+                retargeted = true;
+            }
+        }
+    }
+    if (!retargeted) {
+        launchFromNearestLauncher(target);
+    }
+}
+
+// Manual fire assignment: one missile per selected target, falling back to
+// the first target when nothing is selected
+void fireAtSelection() {
+    std::vector<SalvoShot> salvo;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        for (const auto& weakTarget : selection.targets) {
+            if (auto target = weakTarget.lock()) {
+                if (target->isActiveTarget()) {
+                    salvo.push_back(SalvoShot{nearestLaunchPoint(*target), target});
+                }
+            }
+        }
+        if (salvo.empty() && !enemyTargets.empty()) {
+            salvo.push_back(SalvoShot{nearestLaunchPoint(*enemyTargets.front()), enemyTargets.front()});
+        }
+    }
+    launchSalvo(salvo.data(), salvo.size());
+}
+
+// Draw selection rings and the drag box; expired entries are pruned here
+void drawSelection() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    selection.targets.erase(
+        std::remove_if(selection.targets.begin(), selection.targets.end(),
+                       [](const std::weak_ptr<EnemyTarget>& target) { return target.expired(); }),
+        selection.targets.end());
+    selection.missiles.erase(
+        std::remove_if(selection.missiles.begin(), selection.missiles.end(),
+                       [](const std::weak_ptr<DefenseMissile>& missile) { return missile.expired(); }),
+        selection.missiles.end());
+    selection.launchers.erase(
+        std::remove_if(selection.launchers.begin(), selection.launchers.end(),
+                       [](const std::weak_ptr<Launcher>& launcher) { return launcher.expired(); }),
+        selection.launchers.end());
+
+    for (const auto& weakTarget : selection.targets) {
+        if (auto target = weakTarget.lock()) {
+            al_draw_circle(target->getX(), target->getY(), 14, al_map_rgb(255, 255, 255), 1);
+        }
+    }
+    for (const auto& weakMissile : selection.missiles) {
+        if (auto missile = weakMissile.lock()) {
+            al_draw_circle(missile->getX(), missile->getY(), 9, al_map_rgb(255, 255, 255), 1);
+        }
+    }
+    for (const auto& weakLauncher : selection.launchers) {
+        if (auto launcher = weakLauncher.lock()) {
+            al_draw_rectangle(launcher->getX() - 9, launcher->getY() - 9,
+                              launcher->getX() + 9, launcher->getY() + 9, al_map_rgb(255, 255, 255), 1);
+        }
+    }
+
+    if (selection.dragging) {
+        al_draw_rectangle(selection.dragStartX, selection.dragStartY,
+                          selection.dragEndX, selection.dragEndY, al_map_rgb(255, 255, 255), 1);
+    }
+}
+
+// Scatter rough ground and a ridge with gaps across the middle of the map
+void generateTerrain() {
+    for (int patch = 0; patch < 12; ++patch) {
+        int centre = std::rand() % terrain.getCellCount();
+        int radius = 1 + std::rand() % 3;
+        unsigned char cost = static_cast<unsigned char>(2 + std::rand() % 4);
+        int cx = centre % terrain.getCols();
+        int cy = centre / terrain.getCols();
+        for (int y = std::max(cy - radius, 0); y <= std::min(cy + radius, terrain.getRows() - 1); ++y) {
+            for (int x = std::max(cx - radius, 0); x <= std::min(cx + radius, terrain.getCols() - 1); ++x) {
+                terrain.setCost(y * terrain.getCols() + x, cost);
+            }
+        }
+    }
+
+    int ridgeX = terrain.getCols() * 3 / 4;
+    for (int y = 0; y < terrain.getRows(); ++y) {
+        if (y % 8 != 3) {
+            terrain.setCost(y * terrain.getCols() + ridgeX, TerrainGrid::IMPASSABLE);
+        }
+    }
+}
+
+// Flip the cell under (x, y) between open ground and impassable
+void toggleObstacle(float x, float y) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    int cell = terrain.cellAt(x, y);
+    terrain.setCost(cell, terrain.isPassable(cell) ? TerrainGrid::IMPASSABLE : 1);
+    flowFields.onCostChanged(cell);
+}
+
+// Draw costly terrain darker grey and impassable cells brown
+void drawTerrain() {
+    float size = terrain.getCellSize();
+    for (int cell = 0; cell < terrain.getCellCount(); ++cell) {
+        unsigned char cost = terrain.getCost(cell);
+        if (cost == 1) continue;
+        float x = (cell % terrain.getCols()) * size;
+        float y = (cell / terrain.getCols()) * size;
+        ALLEGRO_COLOR color = (cost == TerrainGrid::IMPASSABLE)
+            ? al_map_rgb(90, 60, 30)
+            : al_map_rgb(20 + cost * 8, 20 + cost * 8, 20 + cost * 8);
+        al_draw_filled_rectangle(x, y, x + size, y + size, color);
+    }
+}
+
+// Spawn a wave along its corridor, spread a little around the entry point
+void spawnWave(const RaidPlanner::Wave& wave) {
+    std::vector<TargetSpawn> spawns;
+    spawns.reserve(wave.count);
+    for (int i = 0; i < wave.count; ++i) {
+        float startX = 0.0f;
+        float spread = (static_cast<float>(i) - (wave.count - 1) / 2.0f) * 15.0f;
+        float startY = std::min(std::max(wave.startY + spread, 0.0f), SCREEN_HEIGHT);
+        float speedX = 50.0f + static_cast<float>(std::rand() % 50); // Random speed between 50 and 100
+        float speedY = (wave.endY - wave.startY) * speedX / SCREEN_WIDTH;
+        spawns.push_back(TargetSpawn{Vec2(startX, startY), Vec2(speedX, speedY)});
+    }
+    spawnTargets(spawns.data(), spawns.size());
+}
+
+// Stamp the radar, deploy the launcher battery with its sensors, and place the opening jammers
+void deployDefenses() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    stampRadarCoverage();
+    for (int i = 0; i < 4; ++i) {
+        float offsetY = (static_cast<float>(i) - 1.5f) * 60.0f;
+        launchers.emplace_back(std::make_shared<Launcher>(SCREEN_WIDTH - 30.0f, SCREEN_HEIGHT / 2.0f + offsetY, 40.0f));
+    }
+    for (auto& launcher : launchers) {
+        launcher->sensorId = sensorNetwork.addSensor(launcher->getX(), launcher->getY(), LAUNCHER_SENSOR_RANGE, 1);
+    }
+    jammerField.add(120.0f, 150.0f, 20.0f, 4.0e6f);
+    jammerField.add(80.0f, 450.0f, -15.0f, 4.0e6f);
+}
+
+// Snapshot what the attacker can learn and hand it to the planner
+void observeBattlefield(RaidPlanner& planner) {
+    RaidPlanner::Observation observation;
+    observation.coverage.resize(RaidPlanner::ROWS * RaidPlanner::COLS);
+    float cellWidth = SCREEN_WIDTH / RaidPlanner::COLS;
+    float cellHeight = SCREEN_HEIGHT / RaidPlanner::ROWS;
+
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        for (int row = 0; row < RaidPlanner::ROWS; ++row) {
+            for (int col = 0; col < RaidPlanner::COLS; ++col) {
+                observation.coverage[row * RaidPlanner::COLS + col] = static_cast<float>(
+                    visibility[SIDE_DEFENSE].getCoverage((col + 0.5f) * cellWidth, (row + 0.5f) * cellHeight));
+            }
+        }
+        // Interceptors are only known where the raid's own sensors see them
+        observation.missileX.reserve(defenseMissiles.size());
+        observation.missileY.reserve(defenseMissiles.size());
+        for (const auto& missile : defenseMissiles) {
+            if (!visibility[SIDE_ATTACK].isVisible(missile->getX(), missile->getY())) continue;
+            observation.missileX.push_back(missile->getX());
+            observation.missileY.push_back(missile->getY());
+        }
+        std::swap(observation.killX, battleReport.killX);
+        std::swap(observation.killY, battleReport.killY);
+        observation.leaks = battleReport.leaks;
+        battleReport.leaks = 0;
+    }
+
+    planner.observe(std::move(observation));
+}
+
+// Heap allocations made by the calling thread through operator new, which
+// is replaced here only to count them; the spawn benchmark reports the count.
+// GCC flags the malloc/free pairing once the replacements are inlined, but
+// replacing both sides together is exactly what the standard allows.
+thread_local long heapAllocations = 0;
+
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t bytes) {
+    ++heapAllocations;
+    if (void* memory = std::malloc(bytes ? bytes : 1)) return memory;
+    throw std::bad_alloc();
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// Hardware event count for the calling thread, user space only. Reads -1
+// where the kernel or the virtual machine does not expose the counter.
+class PerfCounter {
+public:
+    enum Event { DTLB_LOAD_MISSES };
+
+    explicit PerfCounter(Event event) {
+#ifdef __linux__
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        if (event == DTLB_LOAD_MISSES) {
+            attributes.type = PERF_TYPE_HW_CACHE;
+            attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#else
+        (void)event;
+#endif
+    }
+    ~PerfCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
 
-    while (currentTime < predictionTime) {
-        x += speedX * deltaTime;
-        y += speedY * deltaTime;
-        al_draw_filled_circle(x, y, 2, al_map_rgb(255, 255, 0));
-        currentTime += deltaTime;
+    void start() {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    long long stop() {
+        long long count = -1;
+#ifdef __linux__
+        if (fd < 0) return count;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+#endif
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+// Kilobytes of this process's anonymous memory backed by transparent huge pages
+long anonHugePagesKb() {
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 14, "AnonHugePages:") == 0) return std::atol(line.c_str() + 14);
+    }
+    return -1;
+}
+
+// Headless micro-benchmarks for the simulation kernels
+int runBenchmarks() {
+    typedef std::chrono::steady_clock Clock;
+    const int entityCount = 100000;
+    const int iterations = 200;
+    const float deltaTime = 1.0f / FPS;
+
+    // Stationary targets spread over the field, so the bounds check in the
+    // kernel never retires any of them
+    targetStore.reserve(entityCount);
+    for (int i = 0; i < entityCount; ++i) {
+        targetStore.push(Vec2(static_cast<float>(std::rand() % static_cast<int>(SCREEN_WIDTH)),
+                              static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT))), Vec2());
+    }
+
+    auto nanosPerEntity = [&](Clock::duration elapsed) {
+        return std::chrono::duration<double, std::nano>(elapsed).count() / (static_cast<double>(entityCount) * iterations);
+    };
+
+    // Target kinematics in calm air
+    EnvironmentSamples environment;
+    sampleEnvironment(targetStore.position, environment);
+    Clock::time_point start = Clock::now();
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        integrateTargets(deltaTime, environment);
+    }
+    double calm = nanosPerEntity(Clock::now() - start);
+
+    // Same kernel with a batched wind-field sample per entity
+    WindField savedField = windField;
+    if (!windField.isLoaded()) windField.makeProcedural(33, 25, 25.0f);
+    start = Clock::now();
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        sampleEnvironment(targetStore.position, environment);
+        integrateTargets(deltaTime, environment);
+    }
+    double windy = nanosPerEntity(Clock::now() - start);
+    windField = savedField;
+    targetStore.resize(0);
+
+    std::cout << "target kinematics, calm:       " << calm << " ns/entity" << std::endl;
+    std::cout << "target kinematics, wind field: " << windy << " ns/entity (+" << (windy - calm) << ")" << std::endl;
+
+    // NUMA placement: a 1M-target world first touched by the main thread
+    // against one placed chunk by chunk, all updated per node. The last run
+    // places it on huge pages, which moves whole 2 MB pages between nodes.
+    FirstTouchHook savedHook = firstTouchHook();
+    bool savedHugePages = HugePages::enabled();
+    for (int mode = 0; mode < 3; ++mode) {
+        const bool placed = mode > 0;
+        firstTouchHook() = placed ? numaFirstTouch : nullptr;
+        HugePages::enabled() = mode == 2;
+        const int worldSize = 1 << 20;
+        targetStore = TargetStore();
+        targetStore.resize(worldSize);
+        for (int i = 0; i < worldSize; ++i) {
+            targetStore.position.set(i, Vec2(static_cast<float>(i % 797), static_cast<float>(i % 593)));
+            targetStore.active[i] = 1;
+        }
+        EnvironmentSamples worldEnvironment;
+        sampleEnvironment(targetStore.position, worldEnvironment);
+        const int worldTicks = 50;
+        start = Clock::now();
+        for (int tick = 0; tick < worldTicks; ++tick) integrateTargets(deltaTime, worldEnvironment);
+        double tickMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / worldTicks;
+        double local = localPageShare(targetStore.position.x.data(), targetStore.size());
+        const char* labels[] = {"main-thread touch:", "placed per node:  ", "placed, huge pages:"};
+        std::cout << "numa, " << worldSize << " targets on " << numaTopology.nodeCount() << " node(s), " << labels[mode]
+                  << " " << tickMillis << " ms/tick, "
+                  << NUMA_CHUNK_ENTITIES * sizeof(float) * numaChunkGroup() / 1024 << " KB placement groups, ";
+        if (local >= 0.0) std::cout << local * 100.0 << "% of pages local to their updating node" << std::endl;
+        else std::cout << "page placement unavailable" << std::endl;
+    }
+    firstTouchHook() = savedHook;
+    targetStore = TargetStore();
+
+    // Huge pages: a 4M-target world updated, then gathered in random order the
+    // way missiles read their targets, with 4 KB pages against 2 MB pages
+    for (int huge = 0; huge < 2; ++huge) {
+        HugePages::enabled() = huge != 0;
+        const int worldSize = 1 << 22;
+        targetStore = TargetStore();
+        targetStore.resize(worldSize);
+        IntArray order(worldSize);
+        for (int i = 0; i < worldSize; ++i) {
+            targetStore.position.set(i, Vec2(static_cast<float>(i % 797), static_cast<float>(i % 593)));
+            targetStore.active[i] = 1;
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), std::minstd_rand(7));
+        EnvironmentSamples worldEnvironment;
+        sampleEnvironment(targetStore.position, worldEnvironment);
+        long hugeKb = anonHugePagesKb();
+
+        PerfCounter tlbMisses(PerfCounter::DTLB_LOAD_MISSES);
+        const int worldTicks = 10;
+        volatile float gathered = 0.0f;
+        tlbMisses.start();
+        start = Clock::now();
+        for (int tick = 0; tick < worldTicks; ++tick) {
+            integrateTargets(deltaTime, worldEnvironment);
+            float sum = 0.0f;
+            for (int i = 0; i < worldSize; ++i) sum += targetStore.position.x[order[i]] + targetStore.position.y[order[i]];
+            gathered = gathered + sum;
+        }
+        double tickMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / worldTicks;
+        long long misses = tlbMisses.stop();
+        std::cout << "huge pages " << (huge ? "on: " : "off:") << " " << worldSize << " targets, " << tickMillis
+                  << " ms/tick, ";
+        if (misses >= 0) std::cout << misses / worldTicks << " dTLB load misses/tick, ";
+        else std::cout << "dTLB counter unavailable, ";
+        if (hugeKb >= 0) std::cout << hugeKb / 1024 << " MB in transparent huge pages" << std::endl;
+        else std::cout << "huge page residency unavailable" << std::endl;
+    }
+    HugePages::Stats& hugeStats = HugePages::stats();
+    std::cout << "huge page mappings: " << hugeStats.explicitMappings << " explicit, " << hugeStats.transparentMappings
+              << " transparent, " << hugeStats.fallbacks << " fell back to 4 KB pages" << std::endl;
+    HugePages::enabled() = savedHugePages;
+    targetStore = TargetStore();
+
+    // Spawning one target per lock against one spawnTargets batch
+    std::vector<TargetSpawn> spawns(entityCount);
+    for (auto& spawn : spawns) {
+        spawn.position = Vec2(0.0f, static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT)));
+        spawn.velocity = Vec2(50.0f + static_cast<float>(std::rand() % 50), 0.0f);
+    }
+    long allocationsBefore = heapAllocations;
+    start = Clock::now();
+    for (const auto& spawn : spawns) {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        addTarget(spawn.position, spawn.velocity);
+    }
+    double singleSpawn = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / entityCount;
+    long singleAllocations = heapAllocations - allocationsBefore;
+    enemyTargets.clear();
+    targetStore = TargetStore();
+    allocationsBefore = heapAllocations;
+    start = Clock::now();
+    spawnTargets(spawns.data(), spawns.size());
+    double bulkSpawn = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / entityCount;
+    long bulkAllocations = heapAllocations - allocationsBefore;
+    enemyTargets.clear();
+    targetStore.resize(0);
+    targetGrid.rebuild(enemyTargets);
+
+    std::cout << "spawn: " << singleSpawn << " ns/target one at a time vs " << bulkSpawn << " ns batched (incl. index), "
+              << singleAllocations << " vs " << bulkAllocations << " heap allocations for " << entityCount << " targets"
+              << std::endl;
+
+    // Sensor scan, 1000 sensors over the targets spread across the field
+    for (auto& spawn : spawns) {
+        spawn.position = Vec2(static_cast<float>(std::rand() % static_cast<int>(SCREEN_WIDTH)),
+                              static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT)));
+    }
+    spawnTargets(spawns.data(), spawns.size());
+    SensorNetwork network;
+    for (int i = 0; i < 1000; ++i) {
+        network.addSensor(static_cast<float>(std::rand() % static_cast<int>(SCREEN_WIDTH)),
+                          static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT)),
+                          40.0f + static_cast<float>(std::rand() % 80), 1);
+    }
+    const int scans = 10;
+    WorkerPool inlinePool(0);
+    auto timeScans = [&](WorkerPool& pool) {
+        Clock::time_point begin = Clock::now();
+        for (int pass = 0; pass < scans; ++pass) network.scan(pass, targetGrid, jammerField, pool);
+        return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / scans;
+    };
+    double serialScan = timeScans(inlinePool);
+    double parallelScan = timeScans(workerPool);
+    size_t contacts = 0;
+    for (size_t i = 0; i < network.size(); ++i) contacts += network.getDetections(static_cast<int>(i)).size();
+    std::cout << "sensor scan, " << network.size() << " sensors x " << entityCount << " targets: " << serialScan
+              << " ms serial, " << parallelScan << " ms on " << workerPool.threadCount() << " threads ("
+              << contacts << " contacts, " << network.getDetected().size() << " targets seen)" << std::endl;
+    enemyTargets.clear();
+    targetStore.resize(0);
+    targetGrid.rebuild(enemyTargets);
+
+    // Radar saturation: raids of growing size inside coverage, measured after tracks settle
+    for (int raidSize : {10, 50, 100, 200, 500, 1000}) {
+        std::vector<TargetSpawn> raid(raidSize);
+        for (auto& spawn : raid) {
+            float bearing = (static_cast<float>(std::rand()) / RAND_MAX - 0.5f) * MATH_PI;
+            float distance = RADAR_RANGE * std::sqrt(static_cast<float>(std::rand()) / RAND_MAX);
+            spawn.position = Vec2(SCREEN_WIDTH - distance * std::cos(bearing),
+                                  SCREEN_HEIGHT / 2.0f + distance * std::sin(bearing));
+        }
+        spawnTargets(raid.data(), raid.size());
+        PhasedArrayRadar testRadar(SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f, RADAR_RANGE);
+        size_t confirmedSum = 0;
+        for (int frame = 0; frame < 20; ++frame) {
+            testRadar.scanFrame(targetGrid, enemyTargets, jammerField);
+            if (frame >= 10) confirmedSum += testRadar.getConfirmed().size();
+        }
+        std::cout << "radar, " << raidSize << " targets in coverage: load " << testRadar.getLoad() * 100.0f << "%, "
+                  << testRadar.trackCount() << " tracks, " << confirmedSum / 10 << " confirmed/frame, "
+                  << testRadar.getDropped() << " dwells dropped" << std::endl;
+        enemyTargets.clear();
+        targetStore.resize(0);
+        targetGrid.rebuild(enemyTargets);
+    }
+
+    // Launch table: build cost, then lookup against simulating the flight
+    LaunchTable table;
+    start = Clock::now();
+    table.build();
+    double buildMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    const int shots = 2000;
+    std::vector<Vec2> shotTargets(shots), shotVelocities(shots);
+    for (int i = 0; i < shots; ++i) {
+        shotTargets[i] = Vec2(static_cast<float>(std::rand() % static_cast<int>(SCREEN_WIDTH)),
+                              static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT)));
+        shotVelocities[i] = Vec2(50.0f + static_cast<float>(std::rand() % 50), static_cast<float>(std::rand() % 60 - 30));
+    }
+    Vec2 launchPoint(SCREEN_WIDTH - 30.0f, SCREEN_HEIGHT / 2.0f);
+    volatile int feasibleCount = 0;
+    start = Clock::now();
+    for (int i = 0; i < shots; ++i) feasibleCount = feasibleCount + (table.feasible(launchPoint, shotTargets[i], shotVelocities[i]) ? 1 : 0);
+    double lookupNanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / shots;
+    start = Clock::now();
+    for (int i = 0; i < shots; ++i) {
+        feasibleCount = feasibleCount + (simulateIntercept<EngineMath>(launchPoint, shotTargets[i], shotVelocities[i]).hit ? 1 : 0);
+    }
+    double simulateNanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / shots;
+    std::cout << "launch table: built in " << buildMillis << " ms, " << lookupNanos << " ns/query vs "
+              << simulateNanos << " ns simulated" << std::endl;
+
+    // Telemetry binning: one block, single map vs per-slice maps on the pool
+    TelemetryBlock events(1 << 22);
+    for (auto& event : events) {
+        event = TelemetryEvent{0, static_cast<uint32_t>(std::rand() % TelemetryEvent::TYPE_COUNT),
+                               static_cast<float>(std::rand() % static_cast<int>(SCREEN_WIDTH)),
+                               static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT))};
+    }
+    HeatMap serialHeat;
+    start = Clock::now();
+    serialHeat.add(events.data(), events.size());
+    double serialBinning = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / events.size();
+    std::vector<HeatMap> partials(workerPool.threadCount() * 4);
+    start = Clock::now();
+    binEvents(events, partials, workerPool);
+    for (size_t i = 1; i < partials.size(); ++i) partials[0].merge(partials[i]);
+    double parallelBinning = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / events.size();
+    std::cout << "telemetry binning: " << serialBinning << " ns/event serial, " << parallelBinning << " ns/event on "
+              << workerPool.threadCount() << " threads incl. reduction" << std::endl;
+
+    // Spatial queries on a 10k-target snapshot, and the cost of publishing it
+    spawns.resize(10000);
+    for (auto& spawn : spawns) {
+        spawn.position = Vec2(static_cast<float>(std::rand() % static_cast<int>(SCREEN_WIDTH)),
+                              static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT)));
+    }
+    spawnTargets(spawns.data(), spawns.size());
+    const int publishes = 100, queries = 10000;
+    double captureMicros = 0.0;
+    start = Clock::now();
+    for (int i = 0; i < publishes; ++i) {
+        Clock::time_point captureStart = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(dataMutex);
+            worldQuery.capture(i);
+        }
+        captureMicros += std::chrono::duration<double, std::micro>(Clock::now() - captureStart).count() / publishes;
+        worldQuery.publish();
+    }
+    double publishMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / publishes;
+    std::shared_ptr<const WorldSnapshot> view = worldQuery.snapshot();
+    size_t results = 0;
+    start = Clock::now();
+    for (int i = 0; i < queries; ++i) {
+        float x = static_cast<float>(std::rand() % static_cast<int>(SCREEN_WIDTH));
+        float y = static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT));
+        results += view->targetsWithin(x, y, 50.0f).size() + view->nearestTargets(x, y, 8).size();
+    }
+    double queryMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries;
+    std::cout << "spatial queries, " << view->targetCount() << " targets: publish " << publishMicros << " us/tick ("
+              << captureMicros << " under dataMutex), "
+              << queryMicros << " us per radius+8-nearest pair (" << results / queries << " results)" << std::endl;
+    view.reset();
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        enemyTargets.clear();
+        targetStore.resize(0);
+        targetGrid.rebuild(enemyTargets);
+        worldQuery.capture(0);
+    }
+    worldQuery.publish();
+
+    // Metrics: per-update cost on the tick path, and the cost of one scrape
+    Counter benchCounter;
+    Histogram benchHistogram({0.001, 0.004, 0.016, 0.064});
+    const int updates = 1 << 22;
+    start = Clock::now();
+    for (int i = 0; i < updates; ++i) {
+        benchCounter.add();
+        benchHistogram.observe(i * 1e-8);
+    }
+    double updateNanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / updates;
+    start = Clock::now();
+    size_t exposition = metrics.render().size();
+    double scrapeMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    std::cout << "metrics: " << updateNanos << " ns per counter+histogram update, scrape " << scrapeMicros
+              << " us for " << exposition << " bytes" << std::endl;
+
+    // Trails: cost of sampling every slot, and the fixed memory behind them
+    TrailBuffer benchTrails(2048, 64, 1);
+    std::vector<int> trailSlots;
+    for (int slot = benchTrails.acquire(); slot >= 0; slot = benchTrails.acquire()) trailSlots.push_back(slot);
+    const int trailTicks = 256;
+    start = Clock::now();
+    for (int tick = 0; tick < trailTicks; ++tick) {
+        for (int slot : trailSlots) benchTrails.record(slot, static_cast<float>(tick), static_cast<float>(slot));
+    }
+    double trailNanos =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (trailTicks * trailSlots.size());
+    std::cout << "trails: " << trailNanos << " ns per sample, " << trailSlots.size() << " slots in "
+              << benchTrails.memoryBytes() / 1024 << " KB (game buffers "
+              << (targetTrails.memoryBytes() + missileTrails.memoryBytes()) / 1024 << " KB)" << std::endl;
+
+    // Statistics in a parallel loop: a proximity sweep counting hits with no
+    // statistics, into one shared atomic, and into per-thread EngineStats slots.
+    // Each mode's speedup over its own single-thread time is compared with the
+    // speedup of the sweep without statistics; best of three runs each.
+    const int sweepSize = 1 << 22;
+    FloatArray sweepX(sweepSize), sweepY(sweepSize);
+    for (int i = 0; i < sweepSize; ++i) {
+        sweepX[i] = static_cast<float>(std::rand() % 800);
+        sweepY[i] = static_cast<float>(std::rand() % 600);
+    }
+    const int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+    const int maxThreads = std::max(2, hardwareThreads);
+    double singleThreadNanos[3] = {};
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        WorkerPool sweepPool(threads - 1);
+        const char* modes[] = {"none", "shared atomic", "per-thread"};
+        double speedup[3] = {};
+        std::cout << "statistics, " << threads << " thread(s):";
+        for (int mode = 0; mode < 3; ++mode) {
+            double nanos = std::numeric_limits<double>::max();
+            for (int run = 0; run < 3; ++run) {
+                std::atomic<long> sharedHits{0};
+                EngineStats sweepStats;
+                start = Clock::now();
+                sweepPool.parallelFor(sweepSize, 4096, [&](int begin, int end) {
+                    for (int i = begin; i < end; ++i) {
+                        float dx = sweepX[i] - 400.0f, dy = sweepY[i] - 300.0f;
+                        if (dx * dx + dy * dy > 150.0f * 150.0f) continue;
+                        if (mode == 1) sharedHits.fetch_add(1, std::memory_order_relaxed);
+                        if (mode == 2) sweepStats.add(STAT_KILLS);
+                    }
+                });
+                sweepStats.endPhase();
+                nanos = std::min(nanos, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / sweepSize);
+            }
+            if (threads == 1) singleThreadNanos[mode] = nanos;
+            speedup[mode] = singleThreadNanos[mode] / nanos;
+            std::cout << " " << modes[mode] << " " << nanos << " ns/entity " << speedup[mode] << "x";
+            if (mode > 0) std::cout << " (" << static_cast<int>(100.0 * speedup[mode] / speedup[0] + 0.5) << "% of no-stats scaling)";
+            std::cout << (mode < 2 ? "," : "");
+        }
+        if (threads > hardwareThreads) std::cout << " [inconclusive: " << hardwareThreads << " hardware thread(s)]";
+        std::cout << std::endl;
+    }
+
+    // Event log: cost of a 100k-event tick on the simulation thread, writer draining to /dev/null
+    EventLog benchLog;
+    if (benchLog.open("/dev/null")) {
+        const int logTicks = 50, eventsPerTick = 100000;
+        double worstTick = 0.0, totalTicks = 0.0;
+        for (int t = 0; t < logTicks; ++t) {
+            benchLog.setTick(t);
+            start = Clock::now();
+            for (int i = 0; i < eventsPerTick; ++i) benchLog.append(EVENT_DETECTION, i, -1, 1.0f, 2.0f);
+            double millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            worstTick = std::max(worstTick, millis);
+            totalTicks += millis;
+        }
+        long stalls = benchLog.appendStalls();
+        benchLog.close();
+        std::cout << "event log, " << eventsPerTick << " events/tick: " << totalTicks / logTicks << " ms mean, "
+                  << worstTick << " ms worst, " << stalls << " writer stalls, " << benchLog.recordsWritten()
+                  << " records written" << std::endl;
+    }
+
+    // Curve tables against the analytic reference, evaluated at runtime
+    const int curveSamples = 1 << 20;
+    std::vector<float> inputs(curveSamples);
+    for (int i = 0; i < curveSamples; ++i) {
+        inputs[i] = 4.0f * static_cast<float>(std::rand()) / RAND_MAX;
+    }
+    float dragError = 0.0f, thrustError = 0.0f;
+    for (float input : inputs) {
+        dragError = std::max(dragError, std::fabs(DRAG_TABLE(input) - dragCoefficientReference(input)));
+        thrustError = std::max(thrustError, std::fabs(THRUST_TABLE(input) - thrustReference(input)));
+    }
+    volatile float sink = 0.0f;
+    start = Clock::now();
+    for (float input : inputs) sink = sink + DRAG_TABLE(input) + THRUST_TABLE(input);
+    double tableNanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / curveSamples;
+    start = Clock::now();
+    for (float input : inputs) sink = sink + dragCoefficientReference(input) + thrustReference(input);
+    double referenceNanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / curveSamples;
+
+    std::cout << "curve tables: max error drag " << dragError << ", thrust " << thrustError << std::endl;
+    std::cout << "curve tables: " << tableNanos << " ns/lookup pair vs " << referenceNanos << " ns analytic" << std::endl;
+
+    // Fast math against <cmath>
+    std::vector<float> angles(curveSamples);
+    for (int i = 0; i < curveSamples; ++i) {
+        angles[i] = (static_cast<float>(std::rand()) / RAND_MAX - 0.5f) * 20.0f;
+    }
+    auto timeMath = [&](float (*function)(float)) {
+        Clock::time_point begin = Clock::now();
+        for (float input : angles) sink = sink + function(input);
+        return std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / curveSamples;
+    };
+    double fastMathNanos = timeMath([](float a) {
+        float sine, cosine;
+        FastMath::sinCos(a, sine, cosine);
+        return FastMath::atan2(sine, cosine) + FastMath::rsqrt(a * a + 1.0f);
+    });
+    double exactMathNanos = timeMath([](float a) {
+        float sine, cosine;
+        ExactMath::sinCos(a, sine, cosine);
+        return ExactMath::atan2(sine, cosine) + ExactMath::rsqrt(a * a + 1.0f);
+    });
+    std::cout << "math: sincos+atan2+rsqrt " << fastMathNanos << " ns fast vs " << exactMathNanos << " ns exact" << std::endl;
+
+    return 0;
+}
+
+// One tick of the scripted battle used by the display-less modes. Same
+// deployment as the interactive game (the caller sets it up); waves follow a
+// fixed script instead of the raid planner, whose worker thread would make
+// the timing nondeterministic.
+void scriptedBattleTick(long tick) {
+    auto start = std::chrono::steady_clock::now();
+    beginTick();
+    const long waveTicks = 2 * FPS;
+    const long detectionTicks = FPS / 2;
+    if (tick % waveTicks == 1) {
+        RaidPlanner::Wave wave;
+        wave.startY = static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT));
+        wave.endY = static_cast<float>(std::rand() % static_cast<int>(SCREEN_HEIGHT));
+        wave.count = 3 + std::rand() % 5;
+        spawnWave(wave);
+    }
+    if (tick % detectionTicks == 0) {
+        detectionTask();
+    }
+    updateEntities(1.0f / FPS);
+    {
+        // No raid planner drains the battle report here; keep soak runs bounded
+        std::lock_guard<std::mutex> lock(dataMutex);
+        battleReport.killX.clear();
+        battleReport.killY.clear();
+        battleReport.leaks = 0;
+    }
+    ticksTotal.add();
+    tickSeconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+// Run a scripted, display-less battle for the given number of ticks and
+// digest the world after every tick. With outPath the digests are recorded;
+// with comparePath they are checked against a recording, normally made by a
+// reference build (-DENGINE_EXACT_MATH) with the same seed, and the first
+// divergent tick and entity are reported. Returns non-zero on divergence.
+int runDigest(long ticks, const char* outPath, const char* comparePath) {
+    std::ofstream out;
+    std::ifstream reference;
+    if (outPath) {
+        out.open(outPath, std::ios::binary);
+        if (!out) {
+            std::cerr << "Failed to create digest file " << outPath << std::endl;
+            return -1;
+        }
+    }
+    if (comparePath) {
+        reference.open(comparePath, std::ios::binary);
+        if (!reference) {
+            std::cerr << "Failed to open digest file " << comparePath << std::endl;
+            return -1;
+        }
+    }
+
+    generateTerrain();
+    deployDefenses();
+
+    WorldDigest digest;
+    std::vector<WorldDigest::Entry> expected;
+    for (long tick = 1; tick <= ticks; ++tick) {
+        scriptedBattleTick(tick);
+
+        std::lock_guard<std::mutex> lock(dataMutex);
+        uint64_t hash = digest.compute(workerPool);
+        const std::vector<WorldDigest::Entry>& entries = digest.getEntries();
+        uint32_t count = static_cast<uint32_t>(entries.size());
+        if (out) {
+            out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+            out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            out.write(reinterpret_cast<const char*>(entries.data()), count * sizeof(WorldDigest::Entry));
+        }
+        if (!comparePath) continue;
+
+        uint64_t expectedHash = 0;
+        uint32_t expectedCount = 0;
+        reference.read(reinterpret_cast<char*>(&expectedHash), sizeof(expectedHash));
+        reference.read(reinterpret_cast<char*>(&expectedCount), sizeof(expectedCount));
+        expected.resize(expectedCount);
+        reference.read(reinterpret_cast<char*>(expected.data()), expectedCount * sizeof(WorldDigest::Entry));
+        if (!reference) {
+            std::cerr << "Digest file " << comparePath << " ends at tick " << tick - 1 << std::endl;
+            return -1;
+        }
+        if (hash == expectedHash) continue;
+
+        // Report the first entity whose record differs
+        std::cout << "DIVERGED at tick " << tick << " (" << expectedCount << " entities in reference, " << count
+                  << " here)" << std::endl;
+        size_t i = 0;
+        while (i < entries.size() && i < expected.size() && entries[i].id == expected[i].id &&
+               entries[i].hash == expected[i].hash) {
+            ++i;
+        }
+        if (i < entries.size()) {
+            bool missile = (entries[i].id & 0x80000000u) != 0;
+            int slot = missile ? static_cast<int>(i - enemyTargets.size()) : static_cast<int>(i);
+            Vec2 position = missile ? defenseMissiles[slot]->getPosition() : enemyTargets[slot]->getPosition();
+            std::cout << "first divergent entity: " << (missile ? "missile " : "target ") << (entries[i].id & 0x7FFFFFFFu)
+                      << " at (" << position.x << ", " << position.y << ")";
+            if (i < expected.size() && expected[i].id != entries[i].id) {
+                std::cout << ", reference has " << ((expected[i].id & 0x80000000u) ? "missile " : "target ")
+                          << (expected[i].id & 0x7FFFFFFFu) << " in its place";
+            }
+            std::cout << std::endl;
+        } else {
+            std::cout << "first divergent entity: reference has " << expected.size() - entries.size()
+                      << " more entities" << std::endl;
+        }
+        return 1;
+    }
+
+    if (comparePath) std::cout << "MATCH: " << ticks << " ticks identical to " << comparePath << std::endl;
+    if (outPath) std::cout << "Recorded " << ticks << " tick digests to " << outPath << std::endl;
+    return 0;
+}
+
+// Render every frameInterval-th tick of the scripted battle into a memory
+// bitmap, without a display, and hand the frames to a FrameEncoder. The
+// simulation only pays for drawing and one copy per recorded frame.
+int runRecording(long ticks, const char* path, int frameInterval, FrameEncoder::Format format) {
+    if (!al_init() || !al_init_primitives_addon()) {
+        std::cerr << "Failed to initialize Allegro!" << std::endl;
+        return -1;
+    }
+    al_init_font_addon();
+
+    // Memory bitmaps render in software and need no display
+    const int width = static_cast<int>(SCREEN_WIDTH), height = static_cast<int>(SCREEN_HEIGHT);
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    ALLEGRO_BITMAP* canvas = al_create_bitmap(width, height);
+    ALLEGRO_FONT* font = al_create_builtin_font();
+    if (!canvas || !font) {
+        std::cerr << "Failed to create the offscreen canvas!" << std::endl;
+        return -1;
+    }
+    al_set_target_bitmap(canvas);
+
+    // One encoder per spare core, and enough buffers to keep them all busy
+    int encoderThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    std::string output = format == FrameEncoder::Y4M ? std::string(path) + ".y4m" : std::string(path);
+    std::unique_ptr<FrameEncoder> encoder(new FrameEncoder(output, format, width, height, static_cast<int>(FPS),
+                                                           frameInterval, encoderThreads, 2 * encoderThreads + 1));
+    if (!encoder->isOpen()) {
+        std::cerr << "Failed to create " << output << std::endl;
+        return -1;
+    }
+
+    generateTerrain();
+    deployDefenses();
+
+    double renderSeconds = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (long tick = 1; tick <= ticks; ++tick) {
+        scriptedBattleTick(tick);
+        if (tick % frameInterval != 0) continue;
+
+        auto frameStart = std::chrono::steady_clock::now();
+        al_clear_to_color(al_map_rgb(0, 0, 0));
+        drawEntities();
+        al_draw_textf(font, al_map_rgb(255, 255, 255), 10, 10, 0, "Tick %ld  Targets: %zu  Missiles: %zu", tick,
+                      enemyTargets.size(), defenseMissiles.size());
+
+        std::unique_ptr<std::vector<unsigned char>> rgb = encoder->acquireBuffer();
+        ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(canvas, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+        if (!region) {
+            std::cerr << "Failed to lock the offscreen canvas!" << std::endl;
+            return -1;
+        }
+        // ABGR_8888_LE is R, G, B, A in memory; the pitch may be negative
+        for (int y = 0; y < height; ++y) {
+            const unsigned char* row = static_cast<const unsigned char*>(region->data) + y * region->pitch;
+            unsigned char* dest = &(*rgb)[y * width * 3];
+            for (int x = 0; x < width; ++x) {
+                dest[x * 3] = row[x * 4];
+                dest[x * 3 + 1] = row[x * 4 + 1];
+                dest[x * 3 + 2] = row[x * 4 + 2];
+            }
+        }
+        al_unlock_bitmap(canvas);
+        encoder->submit(std::move(rgb));
+        renderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+    }
+    encoder->finish();
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long frames = encoder->framesWritten();
+    std::cout << "Recorded " << frames << " frames to " << output << (format == FrameEncoder::PPM ? "_*.ppm" : "")
+              << " with " << encoderThreads << " encoder threads" << std::endl;
+    if (frames > 0) {
+        std::cout << "render+copy " << renderSeconds * 1000.0 / frames << " ms/frame, waited "
+                  << encoder->getStallSeconds() * 1000.0 << " ms for free buffers, total " << totalSeconds << " s"
+                  << std::endl;
+    }
+
+    encoder.reset();
+    al_destroy_font(font);
+    al_destroy_bitmap(canvas);
+    return 0;
+}
+
+// Stream a telemetry file in fixed-size blocks, bin each block on the worker
+// pool, and write one heat map per event type next to outPrefix. Memory stays
+// at one block plus one partial map per slice, whatever the file size.
+int runAnalysis(const char* path, const char* outPrefix) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open telemetry file " << path << std::endl;
+        return -1;
+    }
+
+    const size_t blockEvents = 1 << 20;
+    TelemetryBlock block(blockEvents);
+    std::vector<HeatMap> partials(workerPool.threadCount() * 4);
+    uint64_t eventCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (file) {
+        block.resize(blockEvents);
+        file.read(reinterpret_cast<char*>(block.data()), blockEvents * sizeof(TelemetryEvent));
+        size_t bytes = static_cast<size_t>(file.gcount());
+        if (bytes % sizeof(TelemetryEvent) != 0) {
+            std::cerr << "Telemetry file " << path << " ends in a partial record; ignoring it" << std::endl;
+        }
+        block.resize(bytes / sizeof(TelemetryEvent));
+        binEvents(block, partials, workerPool);
+        eventCount += block.size();
+    }
+    for (size_t i = 1; i < partials.size(); ++i) partials[0].merge(partials[i]);
+    const HeatMap& heat = partials[0];
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Binned " << eventCount << " events in " << seconds << " s on " << workerPool.threadCount()
+              << " threads";
+    if (heat.getMalformed() > 0) std::cout << " (" << heat.getMalformed() << " malformed)";
+    std::cout << std::endl;
+
+    const char* names[TelemetryEvent::TYPE_COUNT] = {"intercepts", "leaks", "misses"};
+    for (int type = 0; type < static_cast<int>(TelemetryEvent::TYPE_COUNT); ++type) {
+        int hotColumn = 0, hotRow = 0;
+        for (int row = 0; row < heat.getRows(); ++row) {
+            for (int column = 0; column < heat.getCols(); ++column) {
+                if (heat.at(type, column, row) > heat.at(type, hotColumn, hotRow)) {
+                    hotColumn = column;
+                    hotRow = row;
+                }
+            }
+        }
+        std::string mapPath = std::string(outPrefix) + "_" + names[type] + ".pgm";
+        if (!heat.writePgm(type, mapPath)) {
+            std::cerr << "Failed to write " << mapPath << std::endl;
+            return -1;
+        }
+        std::cout << names[type] << ": " << heat.total(type) << ", densest cell (" << hotColumn * HeatMap::CELL << ", "
+                  << hotRow * HeatMap::CELL << ") with " << heat.at(type, hotColumn, hotRow) << ", map " << mapPath
+                  << std::endl;
+    }
+
+    // Leak-through corridors: the rows where raids most often reach the defended edge
+    std::vector<std::pair<uint64_t, int>> corridors;
+    for (int row = 0; row < heat.getRows(); ++row) {
+        uint64_t leaks = 0;
+        for (int column = 0; column < heat.getCols(); ++column) leaks += heat.at(TelemetryEvent::LEAK, column, row);
+        if (leaks > 0) corridors.push_back(std::make_pair(leaks, row));
+    }
+    std::sort(corridors.rbegin(), corridors.rend());
+    for (size_t i = 0; i < corridors.size() && i < 3; ++i) {
+        std::cout << "leak corridor y " << corridors[i].second * HeatMap::CELL << "-"
+                  << (corridors[i].second + 1) * HeatMap::CELL << ": " << corridors[i].first << " leaks" << std::endl;
+    }
+    return 0;
+}
+
+// Differential checks of the fast code paths against exact references.
+// Returns non-zero if any check falls outside its tolerance.
+int runVerification() {
+    int failures = 0;
+
+    // Intercept outcomes with fast math against exact math
+    std::minstd_rand random(12345);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const int engagements = 20000;
+    int outcomeMismatches = 0;
+    float worstTimeDelta = 0.0f;
+    for (int i = 0; i < engagements; ++i) {
+        float targetX = unit(random) * SCREEN_WIDTH * 0.8f;
+        float targetY = unit(random) * SCREEN_HEIGHT;
+        float targetVX = 50.0f + unit(random) * 50.0f;
+        float targetVY = (unit(random) - 0.5f) * 60.0f;
+        Vec2 launchPoint(SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f), target(targetX, targetY), velocity(targetVX, targetVY);
+        InterceptOutcome fast = simulateIntercept<FastMath>(launchPoint, target, velocity);
+        InterceptOutcome exact = simulateIntercept<ExactMath>(launchPoint, target, velocity);
+        if (fast.hit != exact.hit) {
+            ++outcomeMismatches;
+        } else if (fast.hit) {
+            worstTimeDelta = std::max(worstTimeDelta, std::fabs(fast.time - exact.time));
+        }
+    }
+    bool interceptsOk = outcomeMismatches <= engagements / 1000 && worstTimeDelta <= 2.0f / FPS;
+    std::cout << (interceptsOk ? "PASS" : "FAIL") << " fast vs exact intercepts: " << outcomeMismatches << "/"
+              << engagements << " outcomes differ, worst intercept time delta " << worstTimeDelta << " s" << std::endl;
+    failures += interceptsOk ? 0 : 1;
+
+    // Documented error bounds of fast_math.h
+    double rsqrtError = 0.0, atan2Error = 0.0, sinCosError = 0.0;
+    std::uniform_real_distribution<float> positive(1e-6f, 1e6f), coordinate(-1000.0f, 1000.0f), angle(-1e4f, 1e4f);
+    for (int i = 0; i < 1000000; ++i) {
+        float value = positive(random);
+        double exactRsqrt = 1.0 / std::sqrt(static_cast<double>(value));
+        rsqrtError = std::max(rsqrtError, std::fabs(fastRsqrt(value) - exactRsqrt) / exactRsqrt);
+
+        float y = coordinate(random), x = coordinate(random);
+        atan2Error = std::max(atan2Error, std::fabs(fastAtan2(y, x) - std::atan2(static_cast<double>(y), static_cast<double>(x))));
+
+        float a = angle(random), sine, cosine;
+        fastSinCos(a, sine, cosine);
+        sinCosError = std::max(sinCosError, std::max(std::fabs(sine - std::sin(static_cast<double>(a))),
+                                                     std::fabs(cosine - std::cos(static_cast<double>(a)))));
+    }
+    // The batch forms, whose odd length also exercises the scalar tail
+    const int batchSize = 100003;
+    std::vector<float> batchY(batchSize), batchX(batchSize), batchAngle(batchSize);
+    std::vector<float> fastAngle(batchSize), fastSine(batchSize), fastCosine(batchSize);
+    std::vector<float> exactAngle(batchSize), exactSine(batchSize), exactCosine(batchSize);
+    for (int i = 0; i < batchSize; ++i) {
+        batchY[i] = coordinate(random);
+        batchX[i] = coordinate(random);
+        batchAngle[i] = angle(random);
+    }
+    FastMath::atan2Batch(batchY.data(), batchX.data(), fastAngle.data(), batchSize);
+    ExactMath::atan2Batch(batchY.data(), batchX.data(), exactAngle.data(), batchSize);
+    FastMath::sinCosBatch(batchAngle.data(), fastSine.data(), fastCosine.data(), batchSize);
+    ExactMath::sinCosBatch(batchAngle.data(), exactSine.data(), exactCosine.data(), batchSize);
+    double batchAtan2Error = 0.0, batchSinCosError = 0.0;
+    for (int i = 0; i < batchSize; ++i) {
+        batchAtan2Error = std::max(batchAtan2Error, static_cast<double>(std::fabs(fastAngle[i] - exactAngle[i])));
+        batchSinCosError = std::max(batchSinCosError, static_cast<double>(std::max(std::fabs(fastSine[i] - exactSine[i]),
+                                                                                   std::fabs(fastCosine[i] - exactCosine[i]))));
+    }
+    bool boundsOk = rsqrtError < 3e-7 && atan2Error < 2e-6 && sinCosError < 4e-7 && batchAtan2Error < 2e-6 &&
+                    batchSinCosError < 4e-7;
+    std::cout << (boundsOk ? "PASS" : "FAIL") << " fast math error bounds: rsqrt " << rsqrtError << " (rel), atan2 "
+              << atan2Error << ", sincos " << sinCosError << "; batch atan2 " << batchAtan2Error << ", batch sincos "
+              << batchSinCosError << std::endl;
+    failures += boundsOk ? 0 : 1;
+
+    // Launch table verdicts against flying each shot
+    const int shots = 20000;
+    int verdictMismatches = 0, wastedShots = 0, infeasible = 0;
+    for (int i = 0; i < shots; ++i) {
+        // Any direction and speed the table covers, including opening shots it should refuse
+        float sine, cosine;
+        ExactMath::sinCos(unit(random) * 2.0f * MATH_PI, sine, cosine);
+        Vec2 launchPoint(SCREEN_WIDTH - 30.0f, unit(random) * SCREEN_HEIGHT);
+        Vec2 target = launchPoint + Vec2(cosine, sine) * (unit(random) * LaunchTable::MAX_RANGE);
+        ExactMath::sinCos(unit(random) * 2.0f * MATH_PI, sine, cosine);
+        Vec2 velocity = Vec2(cosine, sine) * (unit(random) * 150.0f);
+        bool predicted = launchTable.feasible(launchPoint, target, velocity);
+        InterceptOutcome flown = simulateIntercept<EngineMath>(launchPoint, target, velocity);
+        bool actual = flown.hit && beforeLeak(target, velocity, flown.time);
+        if (predicted != actual) ++verdictMismatches;
+        if (predicted && !actual) ++wastedShots;
+        if (!actual) ++infeasible;
+    }
+    bool launchTableOk = verdictMismatches <= shots / 50;
+    std::cout << (launchTableOk ? "PASS" : "FAIL") << " launch table: " << verdictMismatches << "/" << shots
+              << " verdicts differ from simulation (" << wastedShots << " would waste a missile, " << infeasible
+              << " shots out of reach)" << std::endl;
+    failures += launchTableOk ? 0 : 1;
+
+    // Parallel sensor scan against a serial scan and a brute-force distance test
+    std::vector<TargetSpawn> spawns(20000);
+    for (auto& spawn : spawns) spawn.position = Vec2(unit(random) * SCREEN_WIDTH, unit(random) * SCREEN_HEIGHT);
+    spawnTargets(spawns.data(), spawns.size());
+    SensorNetwork parallelNetwork, serialNetwork;
+    std::vector<Sensor> reference;
+    for (int i = 0; i < 200; ++i) {
+        Sensor sensor{unit(random) * SCREEN_WIDTH, unit(random) * SCREEN_HEIGHT, 20.0f + unit(random) * 200.0f,
+                      1 + static_cast<int>(unit(random) * 3.0f)};
+        parallelNetwork.addSensor(sensor.x, sensor.y, sensor.range, sensor.scanEvery);
+        serialNetwork.addSensor(sensor.x, sensor.y, sensor.range, sensor.scanEvery);
+        reference.push_back(sensor);
+    }
+    WorkerPool inlinePool(0);
+    int scanMismatches = 0;
+    for (long pass = 0; pass < 3; ++pass) {
+        parallelNetwork.scan(pass, targetGrid, jammerField, workerPool);
+        serialNetwork.scan(pass, targetGrid, jammerField, inlinePool);
+        if (parallelNetwork.getDetected() != serialNetwork.getDetected()) ++scanMismatches;
+
+        std::vector<unsigned char> seen(enemyTargets.size(), 0);
+        for (int i = 0; i < static_cast<int>(reference.size()); ++i) {
+            if (parallelNetwork.getDetections(i) != serialNetwork.getDetections(i)) ++scanMismatches;
+            std::vector<int> expected;
+            if ((pass + i) % reference[i].scanEvery == 0) {
+                float rangeSq = reference[i].range * reference[i].range;
+                for (size_t t = 0; t < targetStore.size(); ++t) {
+                    float dx = targetStore.position.x[t] - reference[i].x;
+                    float dy = targetStore.position.y[t] - reference[i].y;
+                    if (dx * dx + dy * dy <= rangeSq) {
+                        expected.push_back(static_cast<int>(t));
+                        seen[t] = 1;
+                    }
+                }
+            }
+            std::vector<int> found = parallelNetwork.getDetections(i);
+            std::sort(found.begin(), found.end());
+            if (found != expected) ++scanMismatches;
+        }
+        std::vector<int> expectedDetected;
+        for (size_t t = 0; t < seen.size(); ++t) {
+            if (seen[t]) expectedDetected.push_back(static_cast<int>(t));
+        }
+        if (parallelNetwork.getDetected() != expectedDetected) ++scanMismatches;
+    }
+    enemyTargets.clear();
+    targetStore.resize(0);
+    targetGrid.rebuild(enemyTargets);
+    bool scanOk = scanMismatches == 0;
+    std::cout << (scanOk ? "PASS" : "FAIL") << " parallel sensor scan: " << scanMismatches << " mismatches" << std::endl;
+    failures += scanOk ? 0 : 1;
+
+    // Node-partitioned loops on a two-node layout (both nodes share this machine's
+    // CPUs): every chunk exactly once, including grouped, nested and concurrent calls
+    std::vector<int> allCpus = NumaTopology::singleNode().cpus(0);
+    WorkerPool nodePool(3, NumaTopology({allCpus, allCpus}));
+    std::vector<std::atomic<int>> chunkRuns(997);
+    for (auto& runs : chunkRuns) runs = 0;
+    std::thread rival([&] {
+        for (int round = 0; round < 50; ++round) nodePool.parallelFor(1000, 7, [](int, int) {});
+    });
+    for (int round = 0; round < 50; ++round) {
+        nodePool.parallelForNodes(static_cast<int>(chunkRuns.size()), [&](int begin, int end) {
+            for (int chunk = begin; chunk < end; ++chunk) ++chunkRuns[chunk];
+            nodePool.parallelFor(4, 1, [](int, int) {}); // Runs inline
+        }, round % 2 ? 32 : 1); // Odd rounds use huge-page sized node groups
+    }
+    rival.join();
+    int badChunks = 0;
+    for (auto& runs : chunkRuns) badChunks += runs != 50 ? 1 : 0;
+    bool nodesOk = badChunks == 0;
+    std::cout << (nodesOk ? "PASS" : "FAIL") << " node-partitioned loops: " << badChunks << "/" << chunkRuns.size()
+              << " chunks not run exactly once per loop (" << numaTopology.nodeCount() << " NUMA node(s) here)"
+              << std::endl;
+    failures += nodesOk ? 0 : 1;
+
+    // Sector range tables against the direct jammer sum at each exact bearing
+    JammerField testJammers;
+    testJammers.add(100.0f, 150.0f, 20.0f, 4.0e6f);
+    testJammers.add(200.0f, 500.0f, 0.0f, 1.0e7f);
+    testJammers.add(600.0f, 100.0f, 0.0f, 5.0e5f);
+    JamTable table;
+    table.refresh(SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f, RADAR_RANGE, testJammers);
+    const int probes = 100000;
+    int jamMismatches = 0;
+    for (int i = 0; i < probes; ++i) {
+        float dx = (unit(random) - 1.0f) * RADAR_RANGE, dy = (unit(random) - 0.5f) * 2.0f * RADAR_RANGE;
+        float distance = std::sqrt(dx * dx + dy * dy);
+        if (distance < 1.0f) continue;
+        float direct = JammerField::jammedRange(
+            RADAR_RANGE, testJammers.noiseAt(SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f, dx / distance, dy / distance));
+        if ((distance <= direct) != table.covers(dx, dy)) ++jamMismatches;
+    }
+    // Small moves must not invalidate the tables, larger ones must
+    long version = testJammers.getVersion();
+    testJammers.update(0.25f); // 5 units
+    bool lazyOk = testJammers.getVersion() == version;
+    testJammers.update(0.5f);  // 10 more
+    lazyOk = lazyOk && testJammers.getVersion() != version;
+    // The defense grid's radar coverage follows the table, also after the jammers move
+    VisibilityGrid jammedGrid(SCREEN_WIDTH, SCREEN_HEIGHT, 10.0f);
+    SensorFootprint jammedRadar;
+    int coverageMismatches = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        table.refresh(SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f, RADAR_RANGE, testJammers);
+        jammedGrid.updateShapedSensor(jammedRadar, SCREEN_WIDTH, SCREEN_HEIGHT / 2.0f, RADAR_RANGE, table.getRevision(),
+                                      [&](float dx, float dy) { return table.covers(dx, dy); });
+        for (float py = 5.0f; py < SCREEN_HEIGHT; py += 10.0f) {
+            for (float px = 5.0f; px < SCREEN_WIDTH; px += 10.0f) {
+                float dx = px - SCREEN_WIDTH, dy = py - SCREEN_HEIGHT / 2.0f;
+                bool expected = dx * dx + dy * dy <= RADAR_RANGE * RADAR_RANGE && table.covers(dx, dy);
+                if (jammedGrid.isVisible(px, py) != expected) ++coverageMismatches;
+            }
+        }
+        testJammers.update(2.0f); // Far enough to force a rebuild
+    }
+    bool jamOk = jamMismatches <= probes / 100 && lazyOk && coverageMismatches == 0;
+    std::cout << (jamOk ? "PASS" : "FAIL") << " jamming tables: " << jamMismatches << "/" << probes
+              << " detections differ from the direct sum, lazy rebuild " << (lazyOk ? "ok" : "broken") << ", "
+              << coverageMismatches << " visibility cells disagree with the table" << std::endl;
+    failures += jamOk ? 0 : 1;
+
+    // Parallel telemetry binning against one map fed serially, with junk records mixed in
+    TelemetryBlock events(300000);
+    for (auto& event : events) {
+        event = TelemetryEvent{0, static_cast<uint32_t>(random() % (TelemetryEvent::TYPE_COUNT + 1)),
+                               (unit(random) - 0.1f) * SCREEN_WIDTH * 1.2f, (unit(random) - 0.1f) * SCREEN_HEIGHT * 1.2f};
+    }
+    events[7].x = std::numeric_limits<float>::quiet_NaN();
+    HeatMap serialHeat;
+    serialHeat.add(events.data(), events.size());
+    std::vector<HeatMap> partials(5);
+    TelemetryBlock firstHalf(events.begin(), events.begin() + 123457);
+    TelemetryBlock secondHalf(events.begin() + 123457, events.end());
+    binEvents(firstHalf, partials, workerPool);
+    binEvents(secondHalf, partials, workerPool);
+    for (size_t i = 1; i < partials.size(); ++i) partials[0].merge(partials[i]);
+    bool binningOk = partials[0] == serialHeat;
+    std::cout << (binningOk ? "PASS" : "FAIL") << " telemetry binning: parallel maps "
+              << (binningOk ? "equal" : "differ from") << " the serial map, " << serialHeat.getMalformed()
+              << " malformed records" << std::endl;
+    failures += binningOk ? 0 : 1;
+
+    // Snapshot queries against brute force, then readers racing the publisher
+    std::vector<TargetSpawn> queryTargets(3000);
+    for (auto& spawn : queryTargets) spawn.position = Vec2(unit(random) * SCREEN_WIDTH, unit(random) * SCREEN_HEIGHT);
+    spawnTargets(queryTargets.data(), queryTargets.size());
+    std::vector<SalvoShot> queryShots(500);
+    for (size_t i = 0; i < queryShots.size(); ++i) {
+        queryShots[i] = SalvoShot{Vec2(unit(random) * SCREEN_WIDTH, unit(random) * SCREEN_HEIGHT), enemyTargets[i]};
+    }
+    launchSalvo(queryShots.data(), queryShots.size());
+    int queryMismatches = 0;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        worldQuery.capture(1);
+    }
+    worldQuery.publish();
+    std::shared_ptr<const WorldSnapshot> snapshot = worldQuery.snapshot();
+    for (int q = 0; q < 300; ++q) {
+        float x = unit(random) * SCREEN_WIDTH, y = unit(random) * SCREEN_HEIGHT, radius = unit(random) * 150.0f;
+        std::vector<std::pair<float, int>> byDistance;
+        for (const auto& target : enemyTargets) {
+            Vec2 offset = target->getPosition() - Vec2(x, y);
+            byDistance.push_back(std::make_pair(std::sqrt(offset.lengthSquared()), target->getID()));
+        }
+        std::sort(byDistance.begin(), byDistance.end());
+
+        std::vector<Contact> within = snapshot->targetsWithin(x, y, radius);
+        size_t expectedWithin = 0;
+        for (const auto& entry : byDistance) expectedWithin += entry.first <= radius ? 1 : 0;
+        if (within.size() != expectedWithin) ++queryMismatches;
+        int k = 1 + q % 20;
+        std::vector<Contact> nearest = snapshot->nearestTargets(x, y, k);
+        if (static_cast<int>(nearest.size()) != k) ++queryMismatches;
+        for (size_t i = 0; i < nearest.size(); ++i) {
+            if (std::fabs(nearest[i].distance - byDistance[i].first) > 1e-3f) ++queryMismatches;
+        }
+
+        float x1 = unit(random) * SCREEN_WIDTH, y1 = unit(random) * SCREEN_HEIGHT;
+        std::vector<int> expectedMissiles;
+        for (const auto& missile : defenseMissiles) {
+            if (missile->getX() >= std::min(x, x1) && missile->getX() <= std::max(x, x1) &&
+                missile->getY() >= std::min(y, y1) && missile->getY() <= std::max(y, y1)) {
+                expectedMissiles.push_back(missile->getID());
+            }
+        }
+        std::sort(expectedMissiles.begin(), expectedMissiles.end());
+        std::vector<int> foundMissiles;
+        for (const auto& contact : snapshot->missilesInRect(x, y, x1, y1)) foundMissiles.push_back(contact.id);
+        if (foundMissiles != expectedMissiles) ++queryMismatches;
+    }
+
+    // Readers must always see one whole tick: every target moved by the same amount
+    std::atomic<bool> publishing{true};
+    std::atomic<int> tornReads{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (publishing) {
+                std::shared_ptr<const WorldSnapshot> view = worldQuery.snapshot();
+                if (view->getTick() < 2) continue; // Published before the race started
+                std::vector<Contact> all = view->nearestTargets(SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f, 1 << 20);
+                for (const auto& contact : all) {
+                    if (contact.velocity.x != static_cast<float>(view->getTick())) ++tornReads;
+                }
+                if (static_cast<int>(all.size()) != view->targetCount()) ++tornReads;
+            }
+        });
+    }
+    for (long tick = 2; tick < 300; ++tick) {
+        {
+            std::lock_guard<std::mutex> lock(dataMutex);
+            for (size_t i = 0; i < targetStore.size(); ++i) targetStore.velocity.x[i] = static_cast<float>(tick);
+            worldQuery.capture(tick);
+        }
+        worldQuery.publish();
+    }
+    publishing = false;
+    for (auto& reader : readers) reader.join();
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        enemyTargets.clear();
+        defenseMissiles.clear();
+        targetStore.resize(0);
+        missileStore.resize(0);
+        targetGrid.rebuild(enemyTargets);
+        missileGrid.rebuild(defenseMissiles);
+        worldQuery.capture(0);
+    }
+    worldQuery.publish();
+    bool queriesOk = queryMismatches == 0 && tornReads == 0;
+    std::cout << (queriesOk ? "PASS" : "FAIL") << " spatial queries: " << queryMismatches
+              << " mismatches against brute force, " << tornReads << " torn snapshot reads" << std::endl;
+    failures += queriesOk ? 0 : 1;
+
+    // Sharded metrics must not lose updates when several threads hammer them
+    Counter sharedCounter;
+    Histogram sharedHistogram({0.5});
+    std::vector<std::thread> hammers;
+    for (int t = 0; t < 4; ++t) {
+        hammers.emplace_back([&, t] {
+            for (int i = 0; i < 100000; ++i) {
+                sharedCounter.add();
+                sharedHistogram.observe(t % 2 ? 0.25 : 1.0);
+            }
+        });
     }
+    for (auto& hammer : hammers) hammer.join();
+    std::ostringstream histogramText;
+    sharedHistogram.write(histogramText, "h");
+    bool metricsOk = sharedCounter.value() == 400000 &&
+                     histogramText.str() == "h_bucket{le=\"0.5\"} 200000\nh_bucket{le=\"+Inf\"} 400000\nh_sum 250000\nh_count 400000\n";
+    std::cout << (metricsOk ? "PASS" : "FAIL") << " metrics: " << sharedCounter.value()
+              << "/400000 counter updates from 4 threads" << std::endl;
+    failures += metricsOk ? 0 : 1;
+
+    // Per-thread statistics: nothing lost or double counted across phases
+    EngineStats phaseStats;
+    long firstKills = 0, firstLeaks = 0;
+    for (int phaseIndex = 0; phaseIndex < 2; ++phaseIndex) {
+        std::vector<std::thread> counters;
+        for (int t = 0; t < 4; ++t) {
+            counters.emplace_back([&, t] {
+                for (int i = 0; i < 100000; ++i) {
+                    phaseStats.add(STAT_KILLS);
+                    if (i % 10 == t) phaseStats.add(STAT_LEAKS, 2);
+                }
+            });
+        }
+        for (auto& counter : counters) counter.join();
+        const StatValues& phase = phaseStats.endPhase();
+        if (phaseIndex == 0) {
+            firstKills = phase[STAT_KILLS];
+            firstLeaks = phase[STAT_LEAKS];
+        }
+    }
+    bool statsOk = firstKills == 400000 && firstLeaks == 80000 && phaseStats.total(STAT_KILLS) == 800000 &&
+                   phaseStats.total(STAT_LEAKS) == 160000;
+    std::cout << (statsOk ? "PASS" : "FAIL") << " per-thread statistics: " << phaseStats.total(STAT_KILLS)
+              << "/800000 kills over two phases" << std::endl;
+    failures += statsOk ? 0 : 1;
+
+    // Entity IDs follow creation order while two threads spawn and launch at once
+    std::vector<std::thread> spawners;
+    for (int t = 0; t < 2; ++t) {
+        spawners.emplace_back([] {
+            std::vector<TargetSpawn> batch(10, TargetSpawn{Vec2(100.0f, 100.0f), Vec2(50.0f, 0.0f)});
+            for (int round = 0; round < 200; ++round) {
+                spawnTargets(batch.data(), batch.size());
+                SalvoShot shot;
+                shot.launchPoint = Vec2(SCREEN_WIDTH - 100.0f, SCREEN_HEIGHT / 2.0f);
+                {
+                    std::lock_guard<std::mutex> lock(dataMutex);
+                    shot.target = enemyTargets.back();
+                }
+                launchSalvo(&shot, 1);
+            }
+        });
+    }
+    for (auto& spawner : spawners) spawner.join();
+    int idsOutOfOrder = 0;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        for (size_t i = 1; i < enemyTargets.size(); ++i) {
+            if (enemyTargets[i]->getID() <= enemyTargets[i - 1]->getID()) ++idsOutOfOrder;
+        }
+        for (size_t i = 1; i < defenseMissiles.size(); ++i) {
+            if (defenseMissiles[i]->getID() <= defenseMissiles[i - 1]->getID()) ++idsOutOfOrder;
+        }
+        bool idsOk = idsOutOfOrder == 0 && enemyTargets.size() == 4000 && defenseMissiles.size() == 400;
+        std::cout << (idsOk ? "PASS" : "FAIL") << " entity IDs: " << idsOutOfOrder << " out of creation order across "
+                  << enemyTargets.size() << " targets and " << defenseMissiles.size() << " missiles from 2 threads"
+                  << std::endl;
+        failures += idsOk ? 0 : 1;
+        enemyTargets.clear();
+        defenseMissiles.clear();
+        targetStore.resize(0);
+        missileStore.resize(0);
+        targetGrid.rebuild(enemyTargets);
+        missileGrid.rebuild(defenseMissiles);
+    }
+
+    // Batch kernels against the scalar reference kernels on random battles
+    failures += runFuzz(200, 12345);
+
+    return failures;
+}
+
+// Scalar reference kernels: the straightforward per-entity target, missile
+// and collision updates that the batch kernels replaced, kept with exact math
+// as the behaviour the fast paths must reproduce. Only --fuzz uses them.
+struct ReferenceTarget {
+    Vec2 position, velocity;
+    bool active = true;
+};
+
+struct ReferenceMissile {
+    Vec2 position, velocity;
+    float speed = MISSILE_LAUNCH_SPEED;
+    float flightTime = 0.0f;
+    int target = -1; // Index into the reference targets, -1 if unguided
+    bool active = true;
+};
+
+void referenceTargetUpdate(ReferenceTarget& target, const Vec2& wind, float deltaTime) {
+    target.position += (target.velocity + wind) * deltaTime;
+
+    // Remove target if it goes off-screen
+    if (target.position.x > SCREEN_WIDTH || target.position.y < 0 || target.position.y > SCREEN_HEIGHT) {
+        target.active = false;
+    }
+}
+
+void referenceMissileUpdate(ReferenceMissile& missile, const std::vector<ReferenceTarget>& targets,
+                            const Vec2& wind, float airDensity, float deltaTime) {
+    // Motor thrust against drag for the current Mach number and air density
+    float previousSpeed = missile.speed;
+    missile.speed = missileSpeedStep(missile.speed, missile.flightTime, airDensity, deltaTime);
+    missile.flightTime += deltaTime;
+
+    if (missile.target >= 0) {
+        if (targets[missile.target].active) {
+            // Update velocity towards the target's current position
+            pursuitVelocity<ExactMath>(targets[missile.target].position - missile.position, missile.speed, missile.velocity);
+        } else {
+            // Target is inactive, missile continues in current direction
+            missile.target = -1;
+        }
+    }
+    if (missile.target < 0 && previousSpeed > 0.0f) {
+        missile.velocity *= missile.speed / previousSpeed;
+    }
+
+    missile.position += (missile.velocity + wind) * deltaTime;
+
+    // Remove missile if it goes off-screen or has bled off its energy
+    if (missile.position.x < 0 || missile.position.x > SCREEN_WIDTH || missile.position.y < 0 ||
+        missile.position.y > SCREEN_HEIGHT || missile.speed < MISSILE_MIN_SPEED) {
+        missile.active = false;
+    }
+}
+
+void referenceCollisions(std::vector<ReferenceMissile>& missiles, std::vector<ReferenceTarget>& targets) {
+    for (auto& missile : missiles) {
+        if (!missile.active || missile.target < 0) continue;
+        ReferenceTarget& target = targets[missile.target];
+        if (!target.active) continue;
+        if ((missile.position - target.position).lengthSquared() < KILL_RADIUS * KILL_RADIUS) {
+            missile.active = false;
+            target.active = false;
+        }
+    }
+}
+
+// Whether a reference value sits so close to a decision threshold that
+// rounding differences may legitimately flip the outcome
+bool nearThreshold(float value, float threshold, float tolerance) {
+    return std::fabs(value - threshold) <= tolerance;
+}
+
+// Differential fuzzing: random battles of random size stepped by the batch
+// kernels in the global stores and by the reference kernels side by side.
+// Positions must agree within tolerance and active flags must match unless
+// the reference entity is within tolerance of the threshold that decided
+// it. Returns non-zero if any case fails; the case seed reproduces it.
+int runFuzz(int cases, unsigned int seed) {
+    const float deltaTime = 1.0f / FPS;
+    const float tolerance = 0.05f; // Units, after up to 60 ticks of fast math
+    std::minstd_rand caseSeeds(seed);
+    WindField savedField = windField;
+    int failedCases = 0, marginal = 0;
+
+    for (int c = 0; c < cases; ++c) {
+        unsigned int caseSeed = static_cast<unsigned int>(caseSeeds());
+        std::minstd_rand random(caseSeed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        auto between = [&](float low, float high) { return low + (high - low) * unit(random); };
+
+        WindField calm;
+        windField = calm;
+        if (unit(random) < 0.5f) {
+            windField.makeProcedural(9 + static_cast<int>(unit(random) * 24), 7 + static_cast<int>(unit(random) * 18),
+                                     between(25.0f, 100.0f));
+        }
+
+        // Fresh world in the global stores
+        enemyTargets.clear();
+        defenseMissiles.clear();
+        targetStore.resize(0);
+        missileStore.resize(0);
+        std::vector<ReferenceTarget> targets(1 + static_cast<int>(unit(random) * 300));
+        std::vector<ReferenceMissile> missiles(static_cast<int>(unit(random) * 300));
+        for (auto& target : targets) {
+            target.position = Vec2(between(0.0f, SCREEN_WIDTH), between(0.0f, SCREEN_HEIGHT));
+            target.velocity = Vec2(between(-150.0f, 150.0f), between(-150.0f, 150.0f));
+            addTarget(target.position, target.velocity);
+        }
+        for (auto& missile : missiles) {
+            missile.position = Vec2(between(0.0f, SCREEN_WIDTH), between(0.0f, SCREEN_HEIGHT));
+            missile.speed = between(MISSILE_MIN_SPEED, 600.0f);
+            float sine, cosine; // Missiles always fly at their speed
+            ExactMath::sinCos(between(-MATH_PI, MATH_PI), sine, cosine);
+            missile.velocity = Vec2(cosine, sine) * missile.speed;
+            missile.flightTime = between(0.0f, 3.0f);
+            missile.target = unit(random) < 0.8f ? static_cast<int>(unit(random) * targets.size()) : -1;
+            // Some missiles start right on top of their target
+            if (missile.target >= 0 && unit(random) < 0.1f) {
+                missile.position = targets[missile.target].position + Vec2(between(-20.0f, 20.0f), between(-20.0f, 20.0f));
+            }
+            auto handle = addMissile(missile.position,
+                                     missile.target >= 0 ? enemyTargets[missile.target] : nullptr, missile.speed);
+            int slot = handle->getSlot();
+            missileStore.velocity.set(slot, missile.velocity);
+            missileStore.flightTime[slot] = missile.flightTime;
+        }
+
+        // Step both
+        int steps = 1 + static_cast<int>(unit(random) * 60);
+        int mismatches = 0;
+        EnvironmentSamples environment;
+        std::vector<int> hits;
+        for (int step = 1; step <= steps && mismatches == 0; ++step) {
+            windField.setTime(step * deltaTime);
+            sampleEnvironment(targetStore.position, environment);
+            integrateTargets(deltaTime, environment);
+            for (size_t i = 0; i < targets.size(); ++i) {
+                referenceTargetUpdate(targets[i], environment.wind.get(i), deltaTime);
+            }
+            sampleEnvironment(missileStore.position, environment);
+            std::vector<Vec2> missileWind(missiles.size());
+            std::vector<float> missileDensity(missiles.size());
+            for (size_t i = 0; i < missiles.size(); ++i) {
+                // Reference samples where the reference missile is, one point at a time
+                float wx = 0.0f, wy = 0.0f, density = 1.0f;
+                if (windField.isLoaded()) {
+                    windField.sample(&missiles[i].position.x, &missiles[i].position.y, 1, &wx, &wy, &density);
+                }
+                missileWind[i] = Vec2(wx, wy);
+                missileDensity[i] = density;
+            }
+            integrateMissiles(deltaTime, environment);
+            for (size_t i = 0; i < missiles.size(); ++i) {
+                referenceMissileUpdate(missiles[i], targets, missileWind[i], missileDensity[i], deltaTime);
+            }
+            detectCollisions(hits);
+            for (int slot : hits) {
+                auto target = defenseMissiles[slot]->target.lock();
+                if (!target->isActiveTarget()) continue;
+                defenseMissiles[slot]->setInactive();
+                target->setInactive();
+            }
+            referenceCollisions(missiles, targets);
+
+            // Compare. A flag difference is tolerated only where the reference sits
+            // within tolerance of the threshold that decided it; the case then stops,
+            // since everything downstream of the flip legitimately differs.
+            auto nearEdge = [&](const Vec2& p) {
+                return nearThreshold(p.x, 0.0f, tolerance) || nearThreshold(p.x, SCREEN_WIDTH, tolerance) ||
+                       nearThreshold(p.y, 0.0f, tolerance) || nearThreshold(p.y, SCREEN_HEIGHT, tolerance);
+            };
+            auto nearKill = [&](const Vec2& a, const Vec2& b) {
+                return nearThreshold(std::sqrt((a - b).lengthSquared()), KILL_RADIUS, 2.0f * tolerance);
+            };
+            auto compare = [&](const char* kind, size_t index, const Vec2& expected, const Vec2& actual,
+                               bool expectedActive, bool actualActive, bool marginalFlip) {
+                if (!expectedActive && !actualActive) return;
+                bool closeEnough = std::fabs(actual.x - expected.x) <= tolerance &&
+                                   std::fabs(actual.y - expected.y) <= tolerance;
+                if (closeEnough && expectedActive == actualActive) return;
+                if (closeEnough && marginalFlip) {
+                    ++marginal;
+                    step = steps; // Stop this case
+                    return;
+                }
+                std::cout << "FAIL case " << c << " (seed " << caseSeed << ") tick " << step << ": " << kind << " "
+                          << index << " reference (" << expected.x << ", " << expected.y << ") "
+                          << (expectedActive ? "active" : "inactive") << ", fast (" << actual.x << ", " << actual.y
+                          << ") " << (actualActive ? "active" : "inactive") << std::endl;
+                ++mismatches;
+            };
+            for (size_t i = 0; i < targets.size() && mismatches == 0; ++i) {
+                bool marginalFlip = nearEdge(targets[i].position);
+                for (const auto& missile : missiles) {
+                    if (missile.target == static_cast<int>(i) && nearKill(missile.position, targets[i].position)) {
+                        marginalFlip = true;
+                    }
+                }
+                compare("target", i, targets[i].position, targetStore.position.get(i), targets[i].active,
+                        targetStore.active[i] != 0, marginalFlip);
+            }
+            for (size_t i = 0; i < missiles.size() && mismatches == 0; ++i) {
+                const ReferenceMissile& missile = missiles[i];
+                bool marginalFlip = nearEdge(missile.position) ||
+                                    nearThreshold(missile.speed, MISSILE_MIN_SPEED, 0.01f) ||
+                                    (missile.target >= 0 && nearKill(missile.position, targets[missile.target].position));
+                compare("missile", i, missile.position, missileStore.position.get(i), missile.active,
+                        missileStore.active[i] != 0, marginalFlip);
+            }
+        }
+        if (mismatches > 0) ++failedCases;
+    }
+
+    enemyTargets.clear();
+    defenseMissiles.clear();
+    targetStore.resize(0);
+    missileStore.resize(0);
+    windField = savedField;
+
+    std::cout << (failedCases == 0 ? "PASS" : "FAIL") << " fuzz: " << failedCases << "/" << cases
+              << " cases diverged from the reference kernels (" << marginal
+              << " threshold-marginal flag differences tolerated)" << std::endl;
+    return failedCases == 0 ? 0 : 1;
 }
@@ -0,0 +1,208 @@
+// Binary engagement event log.
+//
+// A log file is an EventLogHeader followed by fixed-size EventRecords. Threads
+// append into their own buffer; full buffers are handed to a background
+// writer thread, so an append is a copy into thread-local memory and only
+// touches the log's mutex once every BUFFER_RECORDS records. Records from
+// different threads are not interleaved in tick order; readers sort by tick
+// when they need to (the records of one thread keep their order).
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum EventType : uint16_t {
+    EVENT_SPAWN,     // subject: target
+    EVENT_DETECTION, // subject: target
+    EVENT_LAUNCH,    // subject: missile, object: target
+    EVENT_RETARGET,  // subject: missile, object: new target
+    EVENT_INTERCEPT, // subject: missile, object: target
+    EVENT_LEAK,      // subject: target
+    EVENT_TYPE_COUNT
+};
+
+inline const char* eventTypeName(uint16_t type) {
+    static const char* names[EVENT_TYPE_COUNT] = {"spawn", "detection", "launch", "retarget", "intercept", "leak"};
+    return type < EVENT_TYPE_COUNT ? names[type] : "unknown";
+}
+
+struct EventRecord {
+    uint32_t tick;
+    uint16_t type;
+    uint16_t reserved;
+    int32_t subject; // Entity IDs; -1 when unused
+    int32_t object;
+    float x, y;
+};
+
+struct EventLogHeader {
+    char magic[8];       // "EVTLOG1\0"
+    uint32_t recordSize; // sizeof(EventRecord), to catch mismatched readers
+    uint32_t reserved;
+};
+
+const char EVENT_LOG_MAGIC[8] = {'E', 'V', 'T', 'L', 'O', 'G', '1', '\0'};
+
+// EventLog class definition
+class EventLog {
+public:
+    static const size_t BUFFER_RECORDS = 4096;
+    static const size_t MAX_QUEUED = 256; // Writer backlog (24 MB) beyond which appends wait
+
+    ~EventLog() { close(); }
+
+    bool open(const char* path) {
+        file = std::fopen(path, "wb");
+        if (!file) return false;
+        EventLogHeader header;
+        std::memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+        header.recordSize = sizeof(EventRecord);
+        header.reserved = 0;
+        std::fwrite(&header, sizeof(header), 1, file);
+        stopping = false;
+        enabled = true;
+        writer = std::thread(&EventLog::run, this);
+        return true;
+    }
+
+    // Hands every thread's partial buffer to the writer, waits for it to drain,
+    // and closes the file. No thread may append concurrently.
+    void close() {
+        if (!enabled) return;
+        enabled = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& buffer : threadBuffers) {
+                if (!buffer->empty()) full.push_back(std::move(*buffer));
+            }
+            threadBuffers.clear();
+            ++generation;
+            stopping = true;
+        }
+        wake.notify_all();
+        writer.join();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    bool isOpen() const { return enabled; }
+
+    // Tick stamped on subsequent records
+    void setTick(long tick) { currentTick.store(static_cast<uint32_t>(tick), std::memory_order_relaxed); }
+
+    void append(EventType type, int subject, int object, float x, float y) {
+        if (!enabled) return;
+        std::vector<EventRecord>& buffer = localBuffer();
+        buffer.push_back(EventRecord{currentTick.load(std::memory_order_relaxed), type, 0, subject, object, x, y});
+        if (buffer.size() == BUFFER_RECORDS) handOff(buffer);
+    }
+
+    // Append a batch of records in one copy; each is stamped with the current tick
+    void append(const EventRecord* records, size_t count) {
+        if (!enabled) return;
+        std::vector<EventRecord>& buffer = localBuffer();
+        uint32_t tick = currentTick.load(std::memory_order_relaxed);
+        while (count > 0) {
+            size_t first = buffer.size();
+            size_t taken = count < BUFFER_RECORDS - first ? count : BUFFER_RECORDS - first;
+            buffer.insert(buffer.end(), records, records + taken);
+            for (size_t i = first; i < buffer.size(); ++i) buffer[i].tick = tick;
+            records += taken;
+            count -= taken;
+            if (buffer.size() == BUFFER_RECORDS) handOff(buffer);
+        }
+    }
+
+    // Hand the calling thread's partial buffer to the writer
+    void flush() {
+        if (!enabled) return;
+        std::vector<EventRecord>& buffer = localBuffer();
+        if (!buffer.empty()) handOff(buffer);
+    }
+
+    long recordsWritten() const { return written.load(); }
+    long appendStalls() const { return stalls.load(); }
+
+private:
+    // This thread's buffer, registered on first use after each open. A thread
+    // is expected to log to one EventLog at a time.
+    std::vector<EventRecord>& localBuffer() {
+        thread_local const EventLog* owner = nullptr;
+        thread_local std::vector<EventRecord>* buffer = nullptr;
+        thread_local long bufferGeneration = -1;
+        if (owner != this || bufferGeneration != generation) {
+            std::lock_guard<std::mutex> lock(mutex);
+            threadBuffers.emplace_back(new std::vector<EventRecord>());
+            buffer = threadBuffers.back().get();
+            buffer->reserve(BUFFER_RECORDS);
+            owner = this;
+            bufferGeneration = generation;
+        }
+        return *buffer;
+    }
+
+    void handOff(std::vector<EventRecord>& buffer) {
+        std::vector<EventRecord> replacement;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (full.size() >= MAX_QUEUED) {
+                ++stalls;
+                drained.wait(lock, [this] { return full.size() < MAX_QUEUED; });
+            }
+            full.push_back(std::move(buffer));
+            if (!spare.empty()) {
+                replacement = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        wake.notify_one();
+        replacement.reserve(BUFFER_RECORDS);
+        buffer = std::move(replacement);
+    }
+
+    void run() {
+        while (true) {
+            std::vector<EventRecord> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !full.empty(); });
+                if (full.empty()) return;
+                batch = std::move(full.front());
+                full.pop_front();
+            }
+            drained.notify_all();
+            std::fwrite(batch.data(), sizeof(EventRecord), batch.size(), file);
+            written += static_cast<long>(batch.size());
+            batch.clear();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (spare.size() < 8) spare.push_back(std::move(batch));
+        }
+    }
+
+    std::FILE* file = nullptr;
+    std::atomic<bool> enabled{false};
+    std::atomic<uint32_t> currentTick{0};
+    std::atomic<long> written{0};
+    std::atomic<long> stalls{0};
+    std::atomic<long> generation{0}; // Bumped by close so threads register afresh
+
+    std::mutex mutex; // Guards everything below
+    std::condition_variable wake, drained;
+    std::vector<std::unique_ptr<std::vector<EventRecord>>> threadBuffers;
+    std::deque<std::vector<EventRecord>> full;
+    std::vector<std::vector<EventRecord>> spare;
+    bool stopping = false;
+    std::thread writer;
+};
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,129 @@
+// Compile with:
+// g++ -std=c++14 -Wall -O2 -o event_log_reader event_log_reader.cpp -lpthread
+//
+// Reads an engagement event log written with --event-log. Prints a summary
+// of the log, or with --dump the records themselves in tick order,
+// optionally limited to one event type, one target or missile, or a tick range.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "event_log.h"
+
+int usage() {
+    std::cerr << "Usage: event_log_reader <file> [--dump] [--type <name>] [--target <id>] [--missile <id>]" << std::endl;
+    std::cerr << "       [--ticks <first> <last>]" << std::endl;
+    return -1;
+}
+
+// Launches, retargets and intercepts name a missile and its target; the rest name a target
+bool isMissileEvent(const EventRecord& record) {
+    return record.type == EVENT_LAUNCH || record.type == EVENT_RETARGET || record.type == EVENT_INTERCEPT;
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    bool dump = false;
+    int type = -1;
+    long targetId = -1, missileId = -1;
+    long firstTick = 0, lastTick = -1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--dump") == 0) {
+            dump = true;
+        } else if (std::strcmp(argv[i], "--type") == 0 && i + 1 < argc) {
+            ++i;
+            for (int t = 0; t < EVENT_TYPE_COUNT; ++t) {
+                if (std::strcmp(argv[i], eventTypeName(static_cast<uint16_t>(t))) == 0) type = t;
+            }
+            if (type < 0) {
+                std::cerr << "Unknown event type " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--target") == 0 && i + 1 < argc) {
+            targetId = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--missile") == 0 && i + 1 < argc) {
+            missileId = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--ticks") == 0 && i + 2 < argc) {
+            firstTick = std::strtol(argv[++i], nullptr, 10);
+            lastTick = std::strtol(argv[++i], nullptr, 10);
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!path) {
+        return usage();
+    }
+
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return -1;
+    }
+    EventLogHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic)) != 0) {
+        std::cerr << path << " is not an event log" << std::endl;
+        std::fclose(file);
+        return -1;
+    }
+    if (header.recordSize != sizeof(EventRecord)) {
+        std::cerr << path << " has " << header.recordSize << "-byte records, this reader expects "
+                  << sizeof(EventRecord) << std::endl;
+        std::fclose(file);
+        return -1;
+    }
+
+    // Stream the records; only the ones selected for --dump are kept
+    long counts[EVENT_TYPE_COUNT] = {};
+    long total = 0, unknown = 0;
+    uint32_t minTick = UINT32_MAX, maxTick = 0;
+    std::vector<EventRecord> block(1 << 16), selected;
+    size_t read;
+    while ((read = std::fread(block.data(), sizeof(EventRecord), block.size(), file)) > 0) {
+        for (size_t i = 0; i < read; ++i) {
+            const EventRecord& record = block[i];
+            ++total;
+            if (record.type < EVENT_TYPE_COUNT) ++counts[record.type]; else ++unknown;
+            minTick = std::min(minTick, record.tick);
+            maxTick = std::max(maxTick, record.tick);
+            if (!dump) continue;
+            if (type >= 0 && record.type != type) continue;
+            bool missileEvent = isMissileEvent(record);
+            long recordTarget = missileEvent ? record.object : record.subject;
+            if (targetId >= 0 && recordTarget != targetId) continue;
+            if (missileId >= 0 && (!missileEvent || record.subject != missileId)) continue;
+            if (lastTick >= 0 && (record.tick < firstTick || record.tick > lastTick)) continue;
+            selected.push_back(record);
+        }
+    }
+    std::fclose(file);
+
+    if (dump) {
+        // Threads flush their buffers independently, so restore tick order
+        std::stable_sort(selected.begin(), selected.end(),
+                         [](const EventRecord& a, const EventRecord& b) { return a.tick < b.tick; });
+        for (const auto& record : selected) {
+            std::cout << record.tick << " " << eventTypeName(record.type);
+            if (isMissileEvent(record)) {
+                std::cout << " missile " << record.subject << " -> target " << record.object;
+            } else {
+                std::cout << " target " << record.subject;
+            }
+            std::cout << " at (" << record.x << ", " << record.y << ")" << std::endl;
+        }
+        return 0;
+    }
+
+    std::cout << total << " events";
+    if (total > 0) std::cout << ", ticks " << minTick << "-" << maxTick;
+    std::cout << std::endl;
+    for (int t = 0; t < EVENT_TYPE_COUNT; ++t) {
+        std::cout << "  " << eventTypeName(static_cast<uint16_t>(t)) << ": " << counts[t] << std::endl;
+    }
+    if (unknown > 0) std::cout << "  unknown: " << unknown << std::endl;
+    return 0;
+}
@@ -0,0 +1,186 @@
+// 2D/3D vector math for the engine.
+//
+// Vec2 and Vec3 are plain value types for per-entity code. Vec2Batch and
+// Vec3Batch hold many vectors in structure-of-arrays form (one aligned array
+// per component); the batch functions below process them four lanes at a
+// time with SSE2, with a scalar loop for the remainder. The arrays come from
+// AlignedAllocator (array_memory.h).
+
+#ifndef VEC_MATH_H
+#define VEC_MATH_H
+
+#include <cstddef>
+#include <vector>
+#include "array_memory.h"
+#include "fast_math.h"
+
+struct Vec2 {
+    float x, y;
+
+    Vec2() : x(0.0f), y(0.0f) {}
+    Vec2(float x, float y) : x(x), y(y) {}
+
+    Vec2 operator+(const Vec2& o) const { return Vec2(x + o.x, y + o.y); }
+    Vec2 operator-(const Vec2& o) const { return Vec2(x - o.x, y - o.y); }
+    Vec2 operator*(float s) const { return Vec2(x * s, y * s); }
+    Vec2& operator+=(const Vec2& o) { x += o.x; y += o.y; return *this; }
+    Vec2& operator-=(const Vec2& o) { x -= o.x; y -= o.y; return *this; }
+    Vec2& operator*=(float s) { x *= s; y *= s; return *this; }
+
+    float dot(const Vec2& o) const { return x * o.x + y * o.y; }
+    float cross(const Vec2& o) const { return x * o.y - y * o.x; }
+    float lengthSquared() const { return x * x + y * y; }
+};
+
+struct Vec3 {
+    float x, y, z;
+
+    Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+    Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+    Vec3 operator+(const Vec3& o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
+    Vec3 operator-(const Vec3& o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
+    Vec3 operator*(float s) const { return Vec3(x * s, y * s, z * s); }
+    Vec3& operator+=(const Vec3& o) { x += o.x; y += o.y; z += o.z; return *this; }
+    Vec3& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+
+    float dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+    Vec3 cross(const Vec3& o) const { return Vec3(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x); }
+    float lengthSquared() const { return x * x + y * y + z * z; }
+};
+
+class Vec2Batch {
+public:
+    FloatArray x, y;
+
+    size_t size() const { return x.size(); }
+    void resize(size_t count) { x.resize(count); y.resize(count); }
+    void reserve(size_t count) { x.reserve(count); y.reserve(count); }
+    void clear() { x.clear(); y.clear(); }
+    void push_back(const Vec2& v) { x.push_back(v.x); y.push_back(v.y); }
+
+    Vec2 get(size_t i) const { return Vec2(x[i], y[i]); }
+    void set(size_t i, const Vec2& v) { x[i] = v.x; y[i] = v.y; }
+    // Copy element from into slot to (used when compacting)
+    void move(size_t from, size_t to) { x[to] = x[from]; y[to] = y[from]; }
+};
+
+class Vec3Batch {
+public:
+    FloatArray x, y, z;
+
+    size_t size() const { return x.size(); }
+    void resize(size_t count) { x.resize(count); y.resize(count); z.resize(count); }
+    void push_back(const Vec3& v) { x.push_back(v.x); y.push_back(v.y); z.push_back(v.z); }
+
+    Vec3 get(size_t i) const { return Vec3(x[i], y[i], z[i]); }
+    void set(size_t i, const Vec3& v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+};
+
+// out[i] = a[i] - b[i]
+inline void subtract(const Vec2Batch& a, const Vec2Batch& b, Vec2Batch& out) {
+    size_t count = a.size(), i = 0;
+    out.resize(count);
+#ifdef __SSE2__
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(&out.x[i], _mm_sub_ps(_mm_loadu_ps(&a.x[i]), _mm_loadu_ps(&b.x[i])));
+        _mm_storeu_ps(&out.y[i], _mm_sub_ps(_mm_loadu_ps(&a.y[i]), _mm_loadu_ps(&b.y[i])));
+    }
+#endif
+    for (; i < count; ++i) {
+        out.x[i] = a.x[i] - b.x[i];
+        out.y[i] = a.y[i] - b.y[i];
+    }
+}
+
+// out[i] = |a[i] - b[i]|^2
+inline void distanceSquared(const Vec2Batch& a, const Vec2Batch& b, float* out) {
+    size_t count = a.size(), i = 0;
+#ifdef __SSE2__
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&a.x[i]), _mm_loadu_ps(&b.x[i]));
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&a.y[i]), _mm_loadu_ps(&b.y[i]));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    }
+#endif
+    for (; i < count; ++i) {
+        float dx = a.x[i] - b.x[i];
+        float dy = a.y[i] - b.y[i];
+        out[i] = dx * dx + dy * dy;
+    }
+}
+
+// position[i] += (velocity[i] + drift[i]) * deltaTime for i in [begin, end)
+inline void integrate(Vec2Batch& position, const Vec2Batch& velocity, const Vec2Batch& drift, float deltaTime,
+                      size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef __SSE2__
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    for (; i + 4 <= end; i += 4) {
+        __m128 vx = _mm_add_ps(_mm_loadu_ps(&velocity.x[i]), _mm_loadu_ps(&drift.x[i]));
+        __m128 vy = _mm_add_ps(_mm_loadu_ps(&velocity.y[i]), _mm_loadu_ps(&drift.y[i]));
+        _mm_storeu_ps(&position.x[i], _mm_add_ps(_mm_loadu_ps(&position.x[i]), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(&position.y[i], _mm_add_ps(_mm_loadu_ps(&position.y[i]), _mm_mul_ps(vy, dt)));
+    }
+#endif
+    for (; i < end; ++i) {
+        position.x[i] += (velocity.x[i] + drift.x[i]) * deltaTime;
+        position.y[i] += (velocity.y[i] + drift.y[i]) * deltaTime;
+    }
+}
+
+inline void integrate(Vec2Batch& position, const Vec2Batch& velocity, const Vec2Batch& drift, float deltaTime) {
+    integrate(position, velocity, drift, deltaTime, 0, position.size());
+}
+
+// out[i] = direction[i] scaled to length[i]. Lanes whose direction is shorter
+// than minLength keep their previous out value.
+inline void scaleToLength(const Vec2Batch& direction, const float* length, float minLength, Vec2Batch& out) {
+    size_t count = direction.size(), i = 0;
+    const float minLengthSq = minLength * minLength;
+#ifdef __SSE2__
+    const __m128 threshold = _mm_set1_ps(minLengthSq);
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_loadu_ps(&direction.x[i]);
+        __m128 dy = _mm_loadu_ps(&direction.y[i]);
+        __m128 lengthSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 valid = _mm_cmpgt_ps(lengthSq, threshold);
+#ifdef ENGINE_EXACT_MATH
+        __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(select4(valid, lengthSq, _mm_set1_ps(1.0f))));
+#else
+        __m128 inverse = fastRsqrt4(select4(valid, lengthSq, _mm_set1_ps(1.0f)));
+#endif
+        __m128 scale = _mm_mul_ps(inverse, _mm_loadu_ps(length + i));
+        _mm_storeu_ps(&out.x[i], select4(valid, _mm_mul_ps(dx, scale), _mm_loadu_ps(&out.x[i])));
+        _mm_storeu_ps(&out.y[i], select4(valid, _mm_mul_ps(dy, scale), _mm_loadu_ps(&out.y[i])));
+    }
+#endif
+    for (; i < count; ++i) {
+        float lengthSq = direction.x[i] * direction.x[i] + direction.y[i] * direction.y[i];
+        if (lengthSq > minLengthSq) {
+            float scale = EngineMath::rsqrt(lengthSq) * length[i];
+            out.x[i] = direction.x[i] * scale;
+            out.y[i] = direction.y[i] * scale;
+        }
+    }
+}
+
+// position[i] += velocity[i] * deltaTime for 3D batches
+inline void integrate(Vec3Batch& position, const Vec3Batch& velocity, float deltaTime) {
+    size_t count = position.size(), i = 0;
+#ifdef __SSE2__
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(&position.x[i], _mm_add_ps(_mm_loadu_ps(&position.x[i]), _mm_mul_ps(_mm_loadu_ps(&velocity.x[i]), dt)));
+        _mm_storeu_ps(&position.y[i], _mm_add_ps(_mm_loadu_ps(&position.y[i]), _mm_mul_ps(_mm_loadu_ps(&velocity.y[i]), dt)));
+        _mm_storeu_ps(&position.z[i], _mm_add_ps(_mm_loadu_ps(&position.z[i]), _mm_mul_ps(_mm_loadu_ps(&velocity.z[i]), dt)));
+    }
+#endif
+    for (; i < count; ++i) {
+        position.x[i] += velocity.x[i] * deltaTime;
+        position.y[i] += velocity.y[i] * deltaTime;
+        position.z[i] += velocity.z[i] * deltaTime;
+    }
+}
+
+#endif // VEC_MATH_H